@@ -0,0 +1,84 @@
+﻿#include "Bench.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <iostream>
+#include <new>
+
+#include <cstdlib>
+
+
+namespace vein::bench {
+
+namespace {
+
+std::atomic<std::uint64_t> allocations{0};
+std::atomic<std::size_t> sink{0};
+
+void* allocate(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc{};
+}
+
+void* allocate(std::size_t size, std::align_val_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    auto const align = static_cast<std::size_t>(alignment);
+    size = (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+#ifdef _WIN32
+    if (auto* p = ::_aligned_malloc(size, align)) return p;
+#else
+    if (auto* p = std::aligned_alloc(align, size)) return p;
+#endif
+    throw std::bad_alloc{};
+}
+
+void deallocate_aligned(void* p) noexcept
+{
+#ifdef _WIN32
+    ::_aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+} // anon
+
+std::uint64_t allocation_count() noexcept
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void consume(std::size_t value) noexcept
+{
+    sink.fetch_add(value, std::memory_order_relaxed);
+}
+
+void report(
+    std::string_view name,
+    std::uint64_t calls,
+    std::chrono::nanoseconds elapsed,
+    std::uint64_t allocations,
+    std::size_t bytes_per_call
+)
+{
+    auto const ns = static_cast<double>(elapsed.count()) / static_cast<double>(calls);
+    auto line = std::format("{:<48} {:>12.1f} ns {:>10.2f} allocs", name, ns, static_cast<double>(allocations) / static_cast<double>(calls));
+    if (bytes_per_call) {
+        line += std::format(" {:>10.1f} MB/s", static_cast<double>(bytes_per_call) * 1e3 / ns);
+    }
+    std::cout << line << std::endl;
+}
+
+}
+
+// The array and nothrow forms forward to these
+void* operator new(std::size_t size) { return vein::bench::allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return vein::bench::allocate(size, alignment); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { vein::bench::deallocate_aligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { vein::bench::deallocate_aligned(p); }
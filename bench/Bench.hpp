@@ -0,0 +1,57 @@
+﻿#ifndef VEIN_BENCH_BENCH_HPP
+#define VEIN_BENCH_BENCH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+
+namespace vein::bench {
+
+// Calls to the global operator new so far, from any thread. Every
+// benchmark links the counting replacement operators in Bench.cpp.
+// C libraries calling malloc() directly (zlib, brotli, zstd) are not seen.
+[[nodiscard]] std::uint64_t allocation_count() noexcept;
+
+// Keeps a result from being optimized away
+void consume(std::size_t value) noexcept;
+
+// One line: nanoseconds and allocations per call, and MB/s if the
+// call processes `bytes_per_call` bytes
+void report(
+    std::string_view name,
+    std::uint64_t calls,
+    std::chrono::nanoseconds elapsed,
+    std::uint64_t allocations,
+    std::size_t bytes_per_call = 0
+);
+
+inline constexpr std::chrono::milliseconds min_time{500};
+
+// Calls `f` once to warm up caches, pools and thread-local buffers,
+// then in doubling batches until `min_time` has passed
+template<class F>
+void run(std::string_view name, std::size_t bytes_per_call, F&& f)
+{
+    using clock = std::chrono::steady_clock;
+
+    f();
+
+    std::uint64_t calls = 0;
+    auto const allocations = allocation_count();
+    auto const start = clock::now();
+    auto elapsed = clock::duration{};
+
+    for (std::uint64_t batch = 1;; batch *= 2) {
+        for (std::uint64_t i = 0; i < batch; ++i) f();
+        calls += batch;
+        elapsed = clock::now() - start;
+        if (elapsed >= min_time) break;
+    }
+
+    report(name, calls, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed), allocation_count() - allocations, bytes_per_call);
+}
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+﻿#include "Bench.hpp"
+
+#include "vein/ByteBuffer.hpp"
+#include "vein/Encoding.hpp"
+
+#include <format>
+#include <string>
+#include <string_view>
+
+
+namespace {
+
+// Markup of roughly `size` bytes that repeats like a listing page does
+std::string make_page(std::size_t size)
+{
+    std::string page = "<!DOCTYPE html><html lang=\"ja\"><head><title>bench</title></head><body><ul class=\"items\">";
+    for (std::size_t i = 0; page.size() < size; ++i) {
+        page += std::format("<li class=\"item\" id=\"item-{}\"><a href=\"/items/{}\">Item {}</a> <span class=\"price\">{} JPY</span></li>", i, i, i, i * 37 % 10000);
+    }
+    page += "</ul></body></html>";
+    return page;
+}
+
+void run_all(vein::EncoderRegistry const& registry, std::string_view label, std::string const& page, vein::CompressionOptions const& options)
+{
+    using namespace vein;
+
+    ByteBuffer out;
+    for (std::size_t i = 1; i < content_encoding_count_v; ++i) {
+        auto const encoding = static_cast<ContentEncoding>(i);
+        if (!registry.available().contains(encoding)) continue;
+
+        auto const name = std::format("{} {} level {}", label, to_string(encoding), options.level);
+
+        // what every response did before pooling: a fresh context. The
+        // encoders' own state is malloc()ed, so it shows up in ns, not allocs.
+        bench::run(name + " make()", page.size(), [&] {
+            out.clear();
+            auto compressor = registry.make(encoding, options);
+            compressor->write(page, out);
+            compressor->finish(out);
+            bench::consume(out.size());
+        });
+
+        bench::run(name + " acquire()", page.size(), [&] {
+            out.clear();
+            auto compressor = registry.acquire(encoding, options);
+            compressor->write(page, out);
+            compressor->finish(out);
+            bench::consume(out.size());
+        });
+    }
+}
+
+} // anon
+
+int main()
+{
+    vein::EncoderRegistry const registry;
+
+    for (auto const size : {1024uz, 32 * 1024uz}) {
+        auto const page = make_page(size);
+        auto const label = std::format("{}KiB", size / 1024);
+
+        run_all(registry, label, page, {.level = 1});
+        run_all(registry, label, page, {});
+    }
+}
@@ -0,0 +1,70 @@
+﻿#include "Bench.hpp"
+
+#include "vein/html/Escape.hpp"
+#include "vein/html/OutputBuffer.hpp"
+
+#include <regex>
+#include <string>
+#include <string_view>
+
+
+namespace {
+
+// The scalar loop escape_html() falls back to without SSE2
+void escape_scalar(std::string& out, std::string_view str)
+{
+    for (char const c : str) {
+        switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        case '\'': out += "&#39;"; break;
+        default: out += c; break;
+        }
+    }
+}
+
+std::string repeat(std::string_view unit, std::size_t size)
+{
+    std::string str;
+    while (str.size() < size) str += unit;
+    str.resize(size);
+    return str;
+}
+
+void run_all(std::string_view label, std::string const& input)
+{
+    using namespace vein;
+
+    html::OutputBuffer buf;
+    bench::run(std::string{label} + " escape_html", input.size(), [&] {
+        buf.clear();
+        html::escape_html(buf, input);
+        bench::consume(buf.view().size());
+    });
+
+    std::string scalar;
+    bench::run(std::string{label} + " scalar loop", input.size(), [&] {
+        scalar.clear();
+        escape_scalar(scalar, input);
+        bench::consume(scalar.size());
+    });
+
+    // what attribute values went through before: quotes only
+    static std::regex const quotes_rgx{R"(")"};
+    bench::run(std::string{label} + " regex_replace (quotes only)", input.size(), [&] {
+        bench::consume(std::regex_replace(input, quotes_rgx, "&quot;").size());
+    });
+}
+
+} // anon
+
+int main()
+{
+    constexpr std::size_t size = 4096;
+
+    run_all("plain ascii", repeat("The quick brown fox jumps over the lazy dog. ", size));
+    run_all("dense markup", repeat("Tom & Jerry say \"hi\" to <you>. ", size));
+    run_all("utf-8 japanese", repeat("吾輩は猫である。名前はまだ無い。", size));
+}
@@ -0,0 +1,73 @@
+﻿#include "Bench.hpp"
+
+#include "vein/MIME.hpp"
+
+#include <boost/locale/conversion.hpp>
+#include <boost/locale/generator.hpp>
+#include <boost/locale/util.hpp>
+
+#include <array>
+#include <filesystem>
+#include <string_view>
+
+
+namespace {
+
+// mime_type() as it was before the table: a locale per call, then a chain
+// of comparisons
+vein::MIME mime_type_before(std::filesystem::path const& path)
+{
+    boost::locale::generator gen;
+    gen.locale_cache_enabled(true);
+    auto const loc = gen(boost::locale::util::get_system_locale(true));
+    auto const ext = boost::locale::to_lower(path.extension().string(), loc);
+
+    if (ext == ".htm")  return {"text/html; charset=utf-8"};
+    if (ext == ".html") return {"text/html; charset=utf-8"};
+    if (ext == ".php")  return {"text/html; charset=utf-8"};
+    if (ext == ".css")  return {"text/css; charset=utf-8"};
+    if (ext == ".txt")  return {"text/plain; charset=utf-8"};
+    if (ext == ".js")   return {"application/javascript; charset=utf-8"};
+    if (ext == ".json") return {"application/json; charset=utf-8"};
+    if (ext == ".xml")  return {"application/xml; charset=utf-8"};
+    if (ext == ".flv")  return {"video/x-flv", true};
+    if (ext == ".png")  return {"image/png", true};
+    if (ext == ".jpe")  return {"image/jpeg", true};
+    if (ext == ".jpeg") return {"image/jpeg", true};
+    if (ext == ".jpg")  return {"image/jpeg", true};
+    if (ext == ".gif")  return {"image/gif", true};
+    if (ext == ".bmp")  return {"image/bmp"};
+    if (ext == ".ico")  return {"image/vnd.microsoft.icon", true};
+    if (ext == ".tiff") return {"image/tiff", true};
+    if (ext == ".tif")  return {"image/tiff", true};
+    if (ext == ".svg")  return {"image/svg+xml"};
+    if (ext == ".svgz") return {"image/svg+xml"};
+    return {"application/text"};
+}
+
+} // anon
+
+int main()
+{
+    using namespace vein;
+
+    std::array<std::filesystem::path, 8> const paths{
+        "/index.html",
+        "/css/index.css",
+        "/js/index.js",
+        "/img/Logo.PNG",
+        "/img/photo.jpeg",
+        "/video/intro.flv",
+        "/fonts/main.woff2",
+        "/data/unknown.xyz",
+    };
+
+    std::size_t i = 0;
+    bench::run("mime_type()", 0, [&] {
+        bench::consume(mime_type(paths[i++ % paths.size()]).type.size());
+    });
+
+    bench::run("mime_type() before (boost::locale)", 0, [&] {
+        bench::consume(mime_type_before(paths[i++ % paths.size()]).type.size());
+    });
+}
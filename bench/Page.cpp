@@ -0,0 +1,114 @@
+﻿#include "Page.hpp"
+
+#include <format>
+#include <string>
+#include <utility>
+
+
+namespace vein::bench {
+
+namespace {
+
+using html::TagType;
+
+html::TagPtr tag(TagType type)
+{
+    return html::allocate_tag(std::pmr::get_default_resource(), type);
+}
+
+html::Tag& append(html::Tag& parent, html::TagPtr child)
+{
+    auto& res = *child;
+    parent.contents().emplace_back(std::move(child));
+    return res;
+}
+
+html::TagPtr make_head()
+{
+    auto head = tag(TagType::head);
+    append(*head, tag(TagType::meta)).attrs().emplace("charset", "UTF-8");
+
+    auto& viewport = append(*head, tag(TagType::meta)).attrs();
+    viewport.emplace("name", "viewport");
+    viewport.emplace("content", "width=device-width, initial-scale=1, viewport-fit=cover");
+
+    append(*head, tag(TagType::title)).contents().emplace_back(html::Text{"Hello, world!"});
+
+    auto& script = append(*head, tag(TagType::script)).attrs();
+    script.emplace("src", "/js/index.js");
+    script.try_emplace("defer");
+
+    auto& link = append(*head, tag(TagType::link)).attrs();
+    link.emplace("rel", "stylesheet");
+    link.emplace("href", "/css/index.css");
+    return head;
+}
+
+html::TagPtr make_html(html::TagPtr body)
+{
+    auto root = tag(TagType::html);
+    root->attrs().emplace("lang", "ja");
+    append(*root, make_head());
+    root->contents().emplace_back(std::string{"\n"});
+    append(*root, std::move(body));
+    return root;
+}
+
+} // anon
+
+html::TagPtr make_readme_page()
+{
+    auto body = tag(TagType::body);
+    body->attrs().emplace("class", html::ClassList{"page-main"});
+
+    auto& main = append(*body, tag(TagType::main));
+    main.attrs().emplace("id", "main");
+
+    auto& div = append(main, tag(TagType::div));
+    div.contents().emplace_back(html::Text{"Hello, world!"});
+    append(div, tag(TagType::br));
+    div.contents().emplace_back(html::Text{"url: /"});
+
+    return make_html(std::move(body));
+}
+
+html::TagPtr make_listing_page(std::size_t items)
+{
+    auto body = tag(TagType::body);
+    body->attrs().emplace("class", html::ClassList{"page-main", "listing"});
+
+    auto& nav_list = append(append(append(*body, tag(TagType::header)), tag(TagType::nav)), tag(TagType::ul));
+    for (std::string_view const section : {"home", "new", "popular", "sale", "about", "contact"}) {
+        auto& a = append(append(nav_list, tag(TagType::li)), tag(TagType::a));
+        a.attrs().emplace("href", std::format("/{}/", section));
+        a.contents().emplace_back(html::Text{std::string{section}});
+    }
+
+    auto& main = append(*body, tag(TagType::main));
+    main.attrs().emplace("id", "main");
+
+    auto& list = append(main, tag(TagType::ul));
+    list.attrs().emplace("class", html::ClassList{"items"});
+
+    for (std::size_t i = 0; i < items; ++i) {
+        auto& li = append(list, tag(TagType::li));
+        li.attrs().emplace("class", html::ClassList{"item", i % 2 ? "odd" : "even"});
+        li.attrs().emplace("data-index", static_cast<int>(i));
+
+        auto& a = append(li, tag(TagType::a));
+        a.attrs().emplace("href", std::format("/items/{}", i));
+        a.attrs().emplace("title", std::format("Item \"{}\" & more", i));
+        a.contents().emplace_back(html::Text{std::format("Item {} <new>", i)});
+
+        auto& price = append(li, tag(TagType::span));
+        price.attrs().emplace("class", html::ClassList{"price"});
+        price.contents().emplace_back(html::Text{std::format("{} JPY", i * 37 % 10000)});
+    }
+
+    auto& footer = append(*body, tag(TagType::footer));
+    footer.contents().emplace_back(std::string{"<small>&copy; vein</small>"});
+
+    return make_html(std::move(body));
+}
+
+}
@@ -0,0 +1,20 @@
+﻿#ifndef VEIN_BENCH_PAGE_HPP
+#define VEIN_BENCH_PAGE_HPP
+
+#include "vein/html/Tag.hpp"
+
+#include <cstddef>
+
+
+namespace vein::bench {
+
+// The page of the README example, as its callback leaves it
+[[nodiscard]] html::TagPtr make_readme_page();
+
+// The same head with a navigation bar and a list of `items` links with
+// prices, about 150 bytes each
+[[nodiscard]] html::TagPtr make_listing_page(std::size_t items);
+
+}
+
+#endif
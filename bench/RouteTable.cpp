@@ -0,0 +1,71 @@
+﻿#include "Bench.hpp"
+
+#include "vein/RouteTable.hpp"
+
+#include <format>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+using namespace vein;
+
+void run_lookups(std::string_view label, RouteTable<int> const& table, std::vector<std::string> const& paths)
+{
+    std::size_t i = 0;
+    bench::run(label, 0, [&] {
+        auto const m = table.match(paths[i++ % paths.size()]);
+        bench::consume(m ? static_cast<std::size_t>(*m.value) + m.params.size() : 0);
+    });
+}
+
+} // anon
+
+int main()
+{
+    // 6000 literal, 3000 parameterized and 1000 wildcard routes
+    RouteTable<int> table;
+    std::unordered_map<std::string, int> exact;
+    int id = 0;
+
+    for (int category = 0; category < 60; ++category) {
+        for (int item = 0; item < 100; ++item) {
+            auto const pattern = std::format("/category{}/item{}", category, item);
+            table.insert(pattern, id);
+            exact.emplace(pattern, id);
+            ++id;
+        }
+    }
+    for (int version = 0; version < 30; ++version) {
+        for (int resource = 0; resource < 100; ++resource) {
+            table.insert(std::format("/api/v{}/resource{}/{{id}}", version, resource), id++);
+        }
+    }
+    for (int dir = 0; dir < 1000; ++dir) {
+        table.insert(std::format("/static{}/*", dir), id++);
+    }
+
+    std::vector<std::string> literal, param, wildcard, miss;
+    for (int n = 0; n < 1024; ++n) {
+        literal.push_back(std::format("/category{}/item{}", n * 7 % 60, n * 13 % 100));
+        param.push_back(std::format("/api/v{}/resource{}/{}", n % 30, n * 11 % 100, 100000 + n));
+        wildcard.push_back(std::format("/static{}/js/app{}.js", n * 17 % 1000, n));
+        miss.push_back(std::format("/category{}/missing{}", n % 60, n));
+    }
+
+    run_lookups("10k routes, literal hit", table, literal);
+    run_lookups("10k routes, {id} hit", table, param);
+    run_lookups("10k routes, * hit", table, wildcard);
+    run_lookups("10k routes, miss", table, miss);
+
+    // Router before the radix tree: exact matches only, keyed by a
+    // std::string built from the request path
+    std::size_t i = 0;
+    bench::run("6k routes, literal hit, unordered_map before", 0, [&] {
+        auto const& path = literal[i++ % literal.size()];
+        auto const it = exact.find(std::string{path.c_str()});
+        bench::consume(it == exact.end() ? 0 : static_cast<std::size_t>(it->second));
+    });
+}
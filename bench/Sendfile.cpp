@@ -0,0 +1,137 @@
+﻿#include "Bench.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+# include <fcntl.h>
+# include <sys/sendfile.h>
+# include <unistd.h>
+#endif
+
+
+#ifdef __linux__
+
+namespace {
+
+using namespace vein;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+// The pieces of HTTPSession's file paths, without the HTTP framing: the
+// body of a file response over a loopback connection whose other end is
+// drained by a thread
+class Loopback
+{
+public:
+    Loopback()
+    {
+        tcp::acceptor acceptor{ioc_, {net::ip::make_address("127.0.0.1"), 0}};
+        client_.connect(acceptor.local_endpoint());
+        acceptor.accept(server_);
+
+        drain_ = std::thread{[fd = client_.native_handle()] {
+            auto const buf = std::make_unique<char[]>(1 << 18);
+            while (::read(fd, buf.get(), 1 << 18) > 0) {}
+        }};
+    }
+
+    ~Loopback()
+    {
+        server_.shutdown(tcp::socket::shutdown_send);
+        drain_.join();
+    }
+
+    [[nodiscard]] int fd() noexcept { return server_.native_handle(); }
+
+private:
+    net::io_context ioc_;
+    tcp::socket server_{ioc_};
+    tcp::socket client_{ioc_};
+    std::thread drain_;
+};
+
+void send_with_sendfile(int out_fd, int in_fd, std::size_t size)
+{
+    off_t offset = 0;
+    while (static_cast<std::size_t>(offset) < size) {
+        if (::sendfile(out_fd, in_fd, &offset, size - static_cast<std::size_t>(offset)) <= 0) {
+            throw std::runtime_error{"sendfile failed"};
+        }
+    }
+}
+
+// The Beast serializer's way: read a buffer's worth, write it out
+void send_with_buffer(int out_fd, int in_fd, std::size_t size, std::vector<char>& buf)
+{
+    for (std::size_t offset = 0; offset < size;) {
+        auto const n = ::pread(in_fd, buf.data(), buf.size(), static_cast<off_t>(offset));
+        if (n <= 0) throw std::runtime_error{"pread failed"};
+
+        for (ssize_t written = 0; written < n;) {
+            auto const w = ::write(out_fd, buf.data() + written, static_cast<std::size_t>(n - written));
+            if (w <= 0) throw std::runtime_error{"write failed"};
+            written += w;
+        }
+        offset += static_cast<std::size_t>(n);
+    }
+}
+
+void run_all(std::filesystem::path const& path, std::size_t size)
+{
+    std::ofstream{path, std::ios::binary} << std::string(size, 'x');
+    auto const in_fd = ::open(path.c_str(), O_RDONLY);
+    if (in_fd < 0) throw std::runtime_error{"open failed"};
+
+    Loopback loopback;
+    auto const label = std::format("{} KiB file", size / 1024);
+
+    bench::run(label + " sendfile(2)", size, [&] {
+        send_with_sendfile(loopback.fd(), in_fd, size);
+    });
+
+    // the fallback in HTTPSession for other platforms
+    std::vector<char> buf(64 * 1024);
+    bench::run(label + " 64 KiB buffer", size, [&] {
+        send_with_buffer(loopback.fd(), in_fd, size, buf);
+    });
+
+    // http::file_body, which static files went through before
+    buf.resize(4 * 1024);
+    bench::run(label + " 4 KiB buffer (http::file_body)", size, [&] {
+        send_with_buffer(loopback.fd(), in_fd, size, buf);
+    });
+
+    ::close(in_fd);
+}
+
+} // anon
+
+int main()
+{
+    auto const path = std::filesystem::temp_directory_path() / "vein_bench_sendfile";
+
+    for (auto const size : {64 * 1024uz, 1024 * 1024uz, 16 * 1024 * 1024uz}) {
+        run_all(path, size);
+    }
+    std::filesystem::remove(path);
+}
+
+#else
+
+int main()
+{
+    std::cout << "sendfile(2) is only used on Linux" << std::endl;
+}
+
+#endif
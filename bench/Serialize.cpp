@@ -0,0 +1,111 @@
+﻿#include "Bench.hpp"
+#include "Page.hpp"
+
+#include "vein/html/OutputBuffer.hpp"
+#include "vein/html/Tag.hpp"
+
+#include <yk/util/overloaded.hpp>
+
+#include <format>
+#include <regex>
+#include <string>
+#include <variant>
+
+
+namespace {
+
+using namespace vein;
+
+std::string quote_before(std::string const& str)
+{
+    static std::regex const quotes_rgx{R"(")"};
+    return std::regex_replace(str, quotes_rgx, "&quot;");
+}
+
+// Tag::str() as it was before write_to(): a string per node, std::format
+// for the tags and regex_replace() for attribute values, concatenated
+// recursively. Text contents are not escaped, as there were none.
+std::string str_before(html::Tag const& tag)
+{
+    auto const type_str = html::to_string(tag.type());
+
+    std::string res;
+    if (tag.attrs().empty()) {
+        res = std::format("<{}>", type_str);
+
+    } else {
+        std::string attrs_str;
+        for (auto const& [k, v] : tag.attrs()) {
+            if (!attrs_str.empty()) attrs_str += ' ';
+
+            std::string attr{k.view()};
+            std::visit(yk::overloaded{
+                [](std::monostate const&) {},
+                [&](int const& v) {
+                    attr += '=';
+                    attr += std::to_string(v);
+                },
+                [&](std::string const& v) {
+                    attr += "=\"";
+                    attr += quote_before(v);
+                    attr += '"';
+                },
+                [&](html::ClassList const& classes) {
+                    std::string joined;
+                    for (auto const& name : classes) {
+                        if (!joined.empty()) joined += ' ';
+                        joined += quote_before(name);
+                    }
+                    attr += "=\"";
+                    attr += joined;
+                    attr += '"';
+                },
+            }, v);
+            attrs_str += attr;
+        }
+        res = std::format("<{} {}>", type_str, attrs_str);
+    }
+
+    for (auto const& content : tag.contents()) {
+        std::visit(yk::overloaded{
+            [&](html::TagPtr const& child) { res += str_before(*child); },
+            [&](std::string const& str) { res += str; },
+            [&](html::Text const& text) { res += text.value; },
+            [&](html::StaticMarkup const& markup) { res += markup.bytes; },
+        }, content);
+    }
+
+    if (!tag.is_void_element()) {
+        res += std::format("</{}>", type_str);
+    }
+    return res;
+}
+
+void run_all(std::string_view label, html::Tag const& page)
+{
+    html::OutputBuffer buf;
+    page.write_to(buf);
+    auto const size = buf.view().size();
+
+    bench::run(std::format("{} ({} bytes) write_to()", label, size), size, [&] {
+        buf.clear();
+        page.write_to(buf);
+        bench::consume(buf.view().size());
+    });
+
+    bench::run(std::format("{} ({} bytes) str()", label, size), size, [&] {
+        bench::consume(page.str().size());
+    });
+
+    bench::run(std::format("{} ({} bytes) str() before", label, size), size, [&] {
+        bench::consume(str_before(page).size());
+    });
+}
+
+} // anon
+
+int main()
+{
+    run_all("README page", *bench::make_readme_page());
+    run_all("listing, 200 items", *bench::make_listing_page(200));
+}
@@ -0,0 +1,169 @@
+﻿#include "Page.hpp"
+
+#include "vein/Controller.hpp"
+#include "vein/Router.hpp"
+#include "vein/Server.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using namespace vein;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+constexpr unsigned connection_count = 64;
+
+// The README page, with the request path patched into #main per request
+class PageController : public CustomController<PageController>
+{
+public:
+    PageController()
+    {
+        this->set_html(std::make_unique<html::Tag>(*bench::make_readme_page()));
+
+        this->set_default_callback([this](boost::urls::url_view const& url, HTTPFields&) {
+            this->tag_by_id("main")->contents().emplace_back(html::Text{std::string{url.path()}});
+            return http::status::ok;
+        });
+    }
+};
+
+void get(tcp::socket& socket, beast::flat_buffer& buffer, http::request<http::empty_body> const& req)
+{
+    http::write(socket, req);
+    http::response<http::string_body> res;
+    http::read(socket, buffer, res);
+}
+
+http::request<http::empty_body> make_request(std::string_view target)
+{
+    http::request<http::empty_body> req{http::verb::get, target, 11};
+    req.set(http::field::host, "localhost");
+    req.set(http::field::accept_encoding, "gzip");
+    return req;
+}
+
+// Retries until the server answers, which also means its signal handler is in place
+void wait_until_ready(tcp::endpoint const& endpoint)
+{
+    for (;;) {
+        try {
+            net::io_context ioc;
+            tcp::socket socket{ioc};
+            socket.connect(endpoint);
+            beast::flat_buffer buffer;
+            get(socket, buffer, make_request("/"));
+            return;
+        } catch (boost::system::system_error const&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+    }
+}
+
+// Responses per second over `connection_count` keep-alive connections,
+// each driven by a client thread of its own
+double measure(tcp::endpoint const& endpoint, std::string_view target, std::chrono::seconds duration)
+{
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> total{0};
+
+    std::vector<std::thread> clients;
+    clients.reserve(connection_count);
+    for (unsigned i = 0; i < connection_count; ++i) {
+        clients.emplace_back([&] {
+            net::io_context ioc;
+            tcp::socket socket{ioc};
+            socket.connect(endpoint);
+
+            auto const req = make_request(target);
+            beast::flat_buffer buffer;
+            std::uint64_t count = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                get(socket, buffer, req);
+                ++count;
+            }
+            total += count;
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    return static_cast<double>(total) / static_cast<double>(duration.count());
+}
+
+} // anon
+
+// vein_bench_server [seconds] [thread counts...]
+int main(int argc, char* argv[])
+{
+    std::chrono::seconds const duration{argc > 1 ? std::stoi(argv[1]) : 3};
+
+    std::vector<unsigned> thread_counts;
+    for (int i = 2; i < argc; ++i) {
+        thread_counts.push_back(static_cast<unsigned>(std::stoul(argv[i])));
+    }
+    if (thread_counts.empty()) {
+        thread_counts = {1, 4, 16, 64};
+    }
+
+    auto const public_root = std::filesystem::temp_directory_path() / "vein_bench_server";
+    std::filesystem::create_directories(public_root);
+    std::ofstream{public_root / "index.css"} << std::string(16 * 1024, ' ');
+
+    std::cout << std::format(
+        "{} keep-alive connections, {} hardware threads shared by the clients and the server\n",
+        connection_count, std::thread::hardware_concurrency()
+    );
+
+    unsigned short port = 18080;
+
+    for (auto const model : {ThreadingModel::shared, ThreadingModel::shard_per_core}) {
+        for (auto const thread_count : thread_counts) {
+            tcp::endpoint const endpoint{net::ip::make_address("127.0.0.1"), port};
+
+            auto router = std::make_unique<Router>(public_root);
+            router->route("/", std::make_unique<PageController>());
+
+            std::thread server_thread{[&, router = std::move(router)]() mutable {
+                Server server;
+                (void)server.wait("127.0.0.1", port, std::move(router), thread_count, model);
+            }};
+            wait_until_ready(endpoint);
+
+            for (std::string_view const target : {"/", "/index.css"}) {
+                std::cout << std::format(
+                    "{:<16} {:>3} threads {:<12} {:>12.0f} req/s\n",
+                    model == ThreadingModel::shared ? "shared" : "shard_per_core",
+                    thread_count, target, measure(endpoint, target, duration)
+                ) << std::flush;
+            }
+
+            // Server::wait returns on SIGINT
+            std::raise(SIGINT);
+            server_thread.join();
+
+            // the closed sockets may linger in TIME_WAIT
+            ++port;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+﻿#include "Bench.hpp"
+#include "Page.hpp"
+
+#include "vein/html/Overlay.hpp"
+#include "vein/html/Tag.hpp"
+
+#include <format>
+#include <memory_resource>
+
+
+namespace {
+
+using namespace vein;
+
+// Bytes a copy of `page` takes, the way Controller sizes its arenas
+std::size_t copy_size(html::Tag const& page)
+{
+    struct Counter final : std::pmr::memory_resource
+    {
+        std::size_t allocated = 0;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            allocated += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+        {
+            return this == &other;
+        }
+    } counter;
+
+    {
+        html::Arena arena{1, &counter};
+        html::Tag const copy{page, arena.resource()};
+    }
+    return counter.allocated;
+}
+
+void run_all(std::string_view label, html::Tag const& page)
+{
+    auto const size = copy_size(page);
+
+    bench::run(std::format("{} heap copy", label), 0, [&] {
+        html::Tag const copy{page};
+        bench::consume(copy.contents().size());
+    });
+
+    bench::run(std::format("{} arena copy, new {} byte arena", label, size), 0, [&] {
+        html::Arena arena{size};
+        html::Tag const copy{page, arena.resource()};
+        bench::consume(copy.contents().size());
+    });
+
+    // what a thread does per reset: the arena outlives the copies
+    html::Arena arena{size};
+    bench::run(std::format("{} arena copy, reused arena", label), 0, [&] {
+        {
+            html::Tag const copy{page, arena.resource()};
+            bench::consume(copy.contents().size());
+        }
+        arena.release();
+    });
+}
+
+} // anon
+
+int main()
+{
+    run_all("README page", *bench::make_readme_page());
+    run_all("listing, 200 items", *bench::make_listing_page(200));
+}
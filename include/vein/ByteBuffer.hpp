@@ -0,0 +1,17 @@
+﻿#ifndef VEIN_BYTE_BUFFER_HPP
+#define VEIN_BYTE_BUFFER_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include "yk/allocator/default_init_allocator.hpp"
+
+#include <vector>
+
+
+namespace vein {
+
+using ByteBuffer = std::vector<char, yk::default_init_allocator<char>>;
+
+}
+
+#endif
@@ -3,7 +3,17 @@
 
 #include "vein/LibraryConfig.hpp"
 #include "vein/html/Document.hpp"
+#include "vein/html/OutputBuffer.hpp"
+#include "vein/html/Overlay.hpp"
+#include "vein/html/RenderPlan.hpp"
+#include "vein/Encoding.hpp"
+#include "vein/Form.hpp"
 #include "vein/HTTPField.hpp"
+#include "vein/PageCache.hpp"
+#include "vein/RequestBody.hpp"
+#include "vein/Response.hpp"
+#include "vein/RouteTable.hpp"
+#include "vein/SharedBody.hpp"
 
 #include "yk/allocator/default_init_allocator.hpp"
 
@@ -12,12 +22,15 @@
 
 #include <boost/beast/http.hpp>
 #include <boost/beast/http/vector_body.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/copy.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/post.hpp>
 
 #include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
 #include <iostream>
 
 
@@ -38,13 +51,22 @@ public:
     void set_html(std::unique_ptr<html::Tag> html)
     {
         reset_html(html_, doc_, std::move(html));
+        html::index_dynamic_tags(*html_, *doc_);
+        plan_ = html::RenderPlan{doctype, *html_, *doc_};
+        overlay_size_ = measure_overlay_size(*doc_);
     }
 
-    void clear_local_doc()
-    {
-        local_html().reset();
-        local_doc().reset();
-    }
+    // Level, strategy and minimum size for compressed responses of this controller
+    void set_compression_options(CompressionOptions const& options) noexcept { compression_options_ = options; }
+    [[nodiscard]] CompressionOptions const& compression_options() const noexcept { return compression_options_; }
+
+    // Size limits for request bodies sent to this controller
+    void set_request_body_options(RequestBodyOptions const& options) noexcept { request_body_options_ = options; }
+    [[nodiscard]] RequestBodyOptions const& request_body_options() const noexcept { return request_body_options_; }
+
+    // Cache whole responses in the router's PageCache; nullopt disables it
+    void set_page_cache_options(std::optional<PageCacheOptions> options);
+    [[nodiscard]] std::optional<PageCacheOptions> const& page_cache_options() const noexcept { return page_cache_options_; }
 
     void set_title(std::string const& title);
 
@@ -71,33 +93,175 @@ public:
         it->second->callback() = std::forward<F>(f);
     }
 
-    auto* tag_by_id(this auto&& self, std::string_view id)
+    // The request being served, for use in callbacks; the results are
+    // valid until the callback returns
+
+    // Path parameters captured by the route
+    [[nodiscard]] RouteParams const& params() const noexcept;
+
+    [[nodiscard]] http::verb method() const noexcept;
+
+    // null if the request was read without a RequestBody
+    [[nodiscard]] RequestBody::value_type const* request_body() const noexcept;
+
+    // The body parsed as a form; empty unless it is urlencoded or multipart.
+    // Throws std::invalid_argument if it is malformed.
+    [[nodiscard]] Form const& form() const;
+
+    // The tags returned below belong to the current request: changes to
+    // them are rendered into its response only, and are discarded with it
+
+    html::Tag* tag_by_id(std::string_view id) const
+    {
+        return overlay().patch(*doc_->tag_by_id(id), *doc_);
+    }
+
+    // Anything under <body> may be modified through the returned tag,
+    // so the request renders the whole tree
+    html::Tag* body_tag() const
     {
-        self.reset_local_doc();
-        return self.local_doc()->tag_by_id(id);
+        auto& overlay = this->overlay();
+        overlay.patch_root(*html_, *doc_);
+        return overlay.patch(*doc_->body_tag, *doc_);
     }
 
-    auto* body_tag(this auto&& self)
+    // HEAD requests get the headers of GET without the body. The page is
+    // not rendered if its length is known from the cache or the plan.
+    // Requests waiting for another one to render the same page are
+    // answered with a DeferredResponse.
+    template <class Body, class Allocator>
+    Response on_request(http::request<Body, http::basic_fields<Allocator>> const& req, boost::urls::url_view url, RouteParams const& params = {}) const
     {
-        self.reset_local_doc();
-        return self.local_doc()->body_tag;
+        auto const encoding = encoders().negotiate(req);
+        bool const head = req.method() == http::verb::head;
+
+        // only GET responses are shared, and HEAD is answered from them
+        auto* const cache = req.method() == http::verb::get || head ? page_cache() : nullptr;
+        if (!cache) {
+            return finish_response(render_response(req, url, params, encoding, head), head);
+        }
+
+        auto key = PageCache::make_key(std::string_view{url.buffer()}, encoding);
+        for (auto const& name : page_cache_options_->vary) {
+            auto const it = req.find(name);
+            PageCache::append_vary_value(key, it == req.end() ? std::string_view{} : std::string_view{it->value()});
+        }
+
+        if (auto entry = cache->find(key)) {
+            if (entry->is_fresh(PageCache::clock_type::now()) || revalidate_in_background(entry, req, url, params, key, encoding)) {
+                return cached_response(std::move(entry), req.version(), req.keep_alive(), head);
+            }
+        }
+
+        // a HEAD miss renders the whole page, which GET requests then reuse
+        if (!page_cache_options_->coalesce) {
+            auto const generation = cache->generation();
+            return store_page(render_response(req, url, params, encoding), std::move(key), generation, nullptr, head);
+        }
+
+        auto flight = cache->join_flight(key);
+
+        if (auto* const pending = std::get_if<PageCache::FlightResult>(&flight)) {
+            return wait_for_flight(*pending, req, url, params, encoding, head);
+        }
+
+        auto& leader = std::get<PageCache::Flight>(flight);
+
+        // the previous flight may have finished between find() and join_flight()
+        if (auto entry = cache->find(key); entry && entry->is_fresh(PageCache::clock_type::now())) {
+            leader.complete(entry);
+            return cached_response(std::move(entry), req.version(), req.keep_alive(), head);
+        }
+
+        auto const generation = cache->generation();
+        return store_page(render_response(req, url, params, encoding), std::move(key), generation, &leader, head);
     }
 
+protected:
+    Controller();
+
+    [[nodiscard]] Router* router() const noexcept { return router_; }
+
+    // The router's encoders, or the built-in ones if this controller is not routed yet
+    [[nodiscard]] EncoderRegistry const& encoders() const noexcept;
+
+    [[nodiscard]] html::Document const* doc() const noexcept { return doc_.get(); }
+    [[nodiscard]] html::Document* doc() noexcept { return doc_.get(); }
+
+private:
+    static constexpr std::string_view doctype = "<!DOCTYPE html>\n";
+
+    static void reset_html(std::unique_ptr<html::Tag>& html_, std::unique_ptr<html::Document>& doc_, std::unique_ptr<html::Tag> html);
+
+    // Bytes copies of all slots of `doc` take from an arena, so that
+    // patching every slot stays within the arena's first block
+    [[nodiscard]] static std::size_t measure_overlay_size(html::Document const& doc);
+
+    // This thread's overlay, which holds the changes of the request it serves
+    [[nodiscard]] html::Overlay& overlay() const;
+
+    // What params() and the other request accessors return
+    struct RequestState
+    {
+        http::verb method = http::verb::get;
+        RouteParams const* params = nullptr;
+        RequestBody::value_type const* body = nullptr;
+        std::string_view content_type;
+        std::optional<Form> form; // parsed on first use
+    };
+
+    // The state of the request this thread is rendering, if any
+    [[nodiscard]] static RequestState*& current_request() noexcept;
+
+    // Makes `state` the current request until destroyed
+    class RequestScope
+    {
+    public:
+        explicit RequestScope(RequestState& state) noexcept
+            : previous_(std::exchange(current_request(), &state))
+        {}
+
+        ~RequestScope() { current_request() = previous_; }
+
+        RequestScope(RequestScope const&) = delete;
+        RequestScope& operator=(RequestScope const&) = delete;
+
+    private:
+        RequestState* previous_;
+    };
+
+    using PageResponse = http::response<http::vector_body<char, yk::default_init_allocator<char>>>;
+
+    // Runs the callback and renders the page. With `measure_only`, the
+    // page is not rendered if page_length() knows its length; the
+    // response then has an empty body and the Content-Length of the page.
     template <class Body, class Allocator>
-    http::message_generator on_request(http::request<Body, http::basic_fields<Allocator>> const& req, boost::urls::url_view url) const
+    [[nodiscard]] PageResponse render_response(http::request<Body, http::basic_fields<Allocator>> const& req, boost::urls::url_view url, RouteParams const& params, ContentEncoding encoding, bool measure_only = false) const
     {
         auto status_code = http::status::ok;
-        std::string response_body;
+        bool has_page = false;
+        bool failed = false;
 
         static thread_local HTTPFields http_fields;
         http_fields.clear();
 
-        try {
-            reset_local_doc();
+        // the callbacks patch this overlay; it is discarded once the page is rendered
+        html::Overlay::Scope const overlay_scope{overlay()};
 
+        RequestState request_state{
+            .method = req.method(),
+            .params = &params,
+            .content_type = std::string_view{req[http::field::content_type]},
+        };
+        if constexpr (std::is_same_v<Body, RequestBody>) {
+            request_state.body = &req.body();
+        }
+        RequestScope const request_scope{request_state};
+
+        try {
             //for (auto const& param : url.params()) {
             //    if (!param.has_value) continue;
-            //    if (auto it = local_doc()->name_tag.find(param.key); it != local_doc()->name_tag.end()) {
+            //    if (auto it = doc_->name_tag.find(param.key); it != doc_->name_tag.end()) {
             //        it->second->attrs()["value"] = param.value;
             //    }
             //}
@@ -105,8 +269,8 @@ public:
             auto const form_action = url.path();
 
             do {
-                if (auto const form_it = local_doc()->form_action_tag.find(form_action);
-                    form_it == local_doc()->form_action_tag.end()
+                if (auto const form_it = doc_->form_action_tag.find(form_action);
+                    form_it == doc_->form_action_tag.end()
                 ) {
                     if (!doc_->default_callback_) {
                         std::cerr << "warning: the url does not match any form actions, and the default callback on the controller was unset" << std::endl;
@@ -128,21 +292,19 @@ public:
                 // ...
 
             } else {
-                response_body = "<!DOCTYPE html>\n" + local_html()->str();
+                has_page = true;
             }
 
         } catch (std::exception const& e) {
             std::cerr << "uncaught exception while dispatching controller: " << e.what() << std::endl;
-            status_code = http::status::internal_server_error;
-            response_body = "Internal server error";
+            failed = true;
 
         } catch (...) {
             std::cerr << "uncaught and uncatchable exception while dispatching controller" << std::endl;
-            status_code = http::status::internal_server_error;
-            response_body = "Internal server error";
+            failed = true;
         }
 
-        http::response<http::vector_body<char, yk::default_init_allocator<char>>> res{status_code, req.version()};
+        PageResponse res{status_code, req.version()};
 
         for (auto const& [field, value] : http_fields) {
             res.set(field, value);
@@ -153,51 +315,154 @@ public:
 
         res.keep_alive(req.keep_alive());
 
-        if (response_body.empty()) {
-            res.prepare_payload();
-            return res;
-        }
+        if (has_page) {
+            res.set(http::field::vary, vary_);
 
-        res.set(http::field::content_encoding, "deflate");
-        {
-            boost::iostreams::array_source src{response_body.data(), response_body.size()};
-            boost::iostreams::filtering_istream is;
-            is.push(boost::iostreams::zlib_compressor());
-            is.push(src);
+            if (auto const length = measure_only ? page_length(encoding) : std::nullopt) {
+                res.content_length(*length);
+                return res;
+            }
 
-            res.body().reserve(response_body.size() / 8);
-            boost::iostreams::copy(is, std::back_inserter(res.body()));
+            if (auto const used = render_page(res.body(), encoding)) {
+                if (*used != ContentEncoding::identity) {
+                    res.set(http::field::content_encoding, to_string(*used));
+                }
+            } else {
+                failed = true;
+            }
         }
+
+        if (failed) {
+            constexpr std::string_view error_body = "Internal server error";
+            res.result(http::status::internal_server_error);
+            res.body().assign(error_body.begin(), error_body.end());
+        }
+
         res.prepare_payload();
         return res;
     }
 
-protected:
-    Controller();
-
-    [[nodiscard]] Router* router() const noexcept { return router_; }
-
-    [[nodiscard]] html::Document const* doc() const noexcept { return doc_.get(); }
-    [[nodiscard]] html::Document* doc() noexcept { return doc_.get(); }
-
-private:
-    static void reset_html(std::unique_ptr<html::Tag>& html_, std::unique_ptr<html::Document>& doc_, std::unique_ptr<html::Tag> html);
+    // Answers from the result of another request's render once it is
+    // done, on the executor of the waiting session, so no thread blocks
+    template <class Body, class Allocator>
+    [[nodiscard]] DeferredResponse wait_for_flight(
+        PageCache::FlightResult const& pending,
+        http::request<Body, http::basic_fields<Allocator>> const& req,
+        boost::urls::url_view url,
+        RouteParams const& params,
+        ContentEncoding encoding,
+        bool head
+    ) const
+    {
+        // only GET and HEAD requests are cached, so the body is not needed
+        struct Waiter
+        {
+            http::request<http::empty_body, http::basic_fields<Allocator>> req;
+            boost::urls::url url;
+            OwnedRouteParams params;
+        };
+
+        auto waiter = std::make_shared<Waiter>(Waiter{{req.base()}, boost::urls::url{url}, OwnedRouteParams{params}});
+
+        return DeferredResponse{
+            .start = [this, pending, waiter, encoding, head](net::any_io_executor executor, DeferredResponse::handler_type handler) {
+                pending.on_complete([this, waiter, encoding, head, executor = std::move(executor), handler = std::move(handler)](PageCache::EntryPtr entry) {
+                    net::post(executor, [this, waiter, encoding, head, handler, entry = std::move(entry)] {
+                        auto const& req = waiter->req;
+                        if (entry) {
+                            handler(cached_response(entry, req.version(), req.keep_alive(), head));
+                            return;
+                        }
+                        // the other response was not shareable, so this one may not be either
+                        handler(finish_response(render_response(req, waiter->url, waiter->params.get(), encoding, head), head));
+                    });
+                });
+            },
+            .keep_alive = req.keep_alive(),
+        };
+    }
 
-    void reset_local_doc() const
+    // Serves a stale entry while its replacement is rendered on the
+    // router's background executor. Returns false if there is none.
+    template <class Body, class Allocator>
+    [[nodiscard]] bool revalidate_in_background(
+        PageCache::EntryPtr const& entry,
+        http::request<Body, http::basic_fields<Allocator>> const& req,
+        boost::urls::url_view url,
+        RouteParams const& params,
+        std::string const& key,
+        ContentEncoding encoding
+    ) const
     {
-        if (!local_doc()) {
-            reset_html(local_html(), local_doc(), std::make_unique<html::Tag>(*html_));
-            local_doc()->default_callback_ = doc_->default_callback_;
+        auto executor = background_executor();
+        if (!executor) return false;
+
+        if (entry->refreshing.exchange(true, std::memory_order_acq_rel)) {
+            return true; // someone else is on it
         }
+
+        // rendered as the GET it is cached for, which has no body
+        http::request<http::empty_body, http::basic_fields<Allocator>> head{req.base()};
+        head.method(http::verb::get);
+
+        // the parameters are views of the request's path, which is gone by then
+        net::post(*executor, [this, entry, req = std::move(head), url = boost::urls::url{url}, params = OwnedRouteParams{params}, key, encoding, generation = page_cache()->generation()] {
+            // the stale entry stays until replaced, so it must be
+            // refreshed again if the fresh one was not stored
+            auto fresh = make_page_cache_entry(render_response(req, url, params.get(), encoding));
+            if (!fresh || !page_cache()->insert(key, std::move(fresh), generation)) {
+                entry->refreshing.store(false, std::memory_order_release);
+            }
+        });
+        return true;
     }
 
-    virtual std::unique_ptr<html::Tag>& local_html() const = 0;
-    virtual std::unique_ptr<html::Document>& local_doc() const = 0;
+    // The router's cache if caching is enabled for this controller
+    [[nodiscard]] PageCache* page_cache() const noexcept;
+
+    // The router's background executor, if any
+    [[nodiscard]] std::optional<net::any_io_executor> background_executor() const;
+
+    // null if the response is not shareable: only 200 responses without
+    // cookies are, since others are specific to the client
+    [[nodiscard]] PageCache::EntryPtr make_page_cache_entry(PageResponse&& res) const;
+
+    // Moves a shareable response into the cache and serves it from there,
+    // completing `flight` if given; `head` drops the body from the reply
+    [[nodiscard]] http::message_generator store_page(PageResponse&& res, std::string key, std::uint64_t generation, PageCache::Flight* flight, bool head) const;
+
+    [[nodiscard]] static http::message_generator cached_response(PageCache::EntryPtr entry, unsigned version, bool keep_alive, bool head);
+
+    // Drops the body if `head`, keeping its Content-Length
+    [[nodiscard]] static http::message_generator finish_response(PageResponse&& res, bool head);
+
+    // The length of the page as render_page() would produce it, if that
+    // is known without rendering: nothing was patched, every slot is
+    // preserialized and the page is too small to be compressed
+    [[nodiscard]] std::optional<std::size_t> page_length(ContentEncoding encoding) const;
+
+    // Renders the tree with the current request's overlay applied
+    void render_html(html::OutputBuffer& out) const;
+
+    // Renders the page into `body`. Compressed pages are fed to the
+    // encoder while they are being serialized, so only the compressed
+    // bytes are held in memory. Returns the coding actually applied, which
+    // is identity for pages below min_size, or nullopt if rendering failed.
+    [[nodiscard]] std::optional<ContentEncoding> render_page(ByteBuffer& body, ContentEncoding encoding) const;
+
+    virtual std::unique_ptr<html::Overlay>& local_overlay() const = 0;
 
     mutable Router* router_ = nullptr;
 
     std::unique_ptr<html::Tag> html_;
     std::unique_ptr<html::Document> doc_;
+    html::RenderPlan plan_;
+    std::size_t overlay_size_ = 0;
+    CompressionOptions compression_options_;
+    RequestBodyOptions request_body_options_;
+
+    std::optional<PageCacheOptions> page_cache_options_;
+    std::string vary_ = "Accept-Encoding";
 };
 
 
@@ -210,15 +475,10 @@ protected:
     using Controller::Controller;
 
 private:
-    std::unique_ptr<html::Tag>& local_html() const override
-    {
-        static thread_local std::unique_ptr<html::Tag> local_html_;
-        return local_html_;
-    }
-    std::unique_ptr<html::Document>& local_doc() const override
+    std::unique_ptr<html::Overlay>& local_overlay() const override
     {
-        static thread_local std::unique_ptr<html::Document> local_doc_;
-        return local_doc_;
+        static thread_local std::unique_ptr<html::Overlay> overlay_;
+        return overlay_;
     }
 };
 
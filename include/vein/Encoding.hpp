@@ -0,0 +1,244 @@
+﻿#ifndef VEIN_ENCODING_HPP
+#define VEIN_ENCODING_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/ByteBuffer.hpp"
+
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/field.hpp>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <cstdint>
+
+
+namespace vein {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+enum class ContentEncoding : std::uint8_t
+{
+    identity,
+    deflate,
+    gzip,
+    br,
+    zstd,
+    _last_ = zstd,
+};
+
+inline constexpr std::size_t content_encoding_count_v = std::to_underlying(ContentEncoding::_last_) + 1;
+
+// The value used for the `Content-Encoding` header
+constexpr std::string_view to_string(ContentEncoding encoding) noexcept
+{
+    switch (encoding) {
+    case ContentEncoding::identity: return "identity";
+    case ContentEncoding::deflate:  return "deflate";
+    case ContentEncoding::gzip:     return "gzip";
+    case ContentEncoding::br:       return "br";
+    case ContentEncoding::zstd:     return "zstd";
+    }
+    return "identity";
+}
+
+// File name suffix of a precompressed sidecar, e.g. "foo.js.br"
+constexpr std::string_view sidecar_extension(ContentEncoding encoding) noexcept
+{
+    switch (encoding) {
+    case ContentEncoding::gzip: return ".gz";
+    case ContentEncoding::br:   return ".br";
+    case ContentEncoding::zstd: return ".zst";
+    default:                    return {};
+    }
+}
+
+inline constexpr auto sidecar_encodings_v = std::array{
+    ContentEncoding::br,
+    ContentEncoding::zstd,
+    ContentEncoding::gzip,
+};
+
+class EncodingSet
+{
+public:
+    constexpr EncodingSet() noexcept = default;
+
+    constexpr EncodingSet(std::initializer_list<ContentEncoding> encodings) noexcept
+    {
+        for (auto const encoding : encodings) insert(encoding);
+    }
+
+    constexpr void insert(ContentEncoding encoding) noexcept { bits_ |= bit(encoding); }
+    constexpr void erase(ContentEncoding encoding) noexcept { bits_ &= ~bit(encoding); }
+
+    [[nodiscard]] constexpr bool contains(ContentEncoding encoding) const noexcept { return bits_ & bit(encoding); }
+    [[nodiscard]] constexpr bool empty() const noexcept { return bits_ == 0; }
+
+    [[nodiscard]] constexpr EncodingSet operator|(EncodingSet other) const noexcept
+    {
+        EncodingSet res;
+        res.bits_ = bits_ | other.bits_;
+        return res;
+    }
+
+private:
+    static constexpr std::uint32_t bit(ContentEncoding encoding) noexcept
+    {
+        return std::uint32_t{1} << std::to_underlying(encoding);
+    }
+
+    std::uint32_t bits_ = 0;
+};
+
+// Parsed `Accept-Encoding` header field value (RFC 9110 12.5.3).
+// Qualities are stored in thousandths; parsing never allocates.
+class AcceptEncoding
+{
+public:
+    static constexpr int max_quality = 1000;
+
+    // A missing header means the client did not ask for any coding.
+    // We answer with identity in that case, since that is the only
+    // coding which every client can decode.
+    AcceptEncoding() noexcept = default;
+
+    explicit AcceptEncoding(std::string_view field_value) noexcept;
+
+    [[nodiscard]] int quality(ContentEncoding encoding) const noexcept;
+
+private:
+    bool present_ = false;
+    int star_ = -1;
+    std::array<int, content_encoding_count_v> quality_{-1, -1, -1, -1, -1};
+};
+
+// Encodings sorted by the server's preference, used for breaking ties
+// between equal qualities. Better ratio wins over cheaper CPU.
+inline constexpr auto encoding_preference_v = std::array{
+    ContentEncoding::br,
+    ContentEncoding::zstd,
+    ContentEncoding::gzip,
+    ContentEncoding::deflate,
+    ContentEncoding::identity,
+};
+
+[[nodiscard]] ContentEncoding negotiate_encoding(AcceptEncoding const& accept, EncodingSet available) noexcept;
+
+template<class Body, class Allocator>
+[[nodiscard]] AcceptEncoding accept_encoding(http::request<Body, http::basic_fields<Allocator>> const& req) noexcept
+{
+    auto const it = req.find(http::field::accept_encoding);
+    if (it == req.end()) {
+        return AcceptEncoding{};
+    }
+    return AcceptEncoding{std::string_view{it->value().data(), it->value().size()}};
+}
+
+template<class Body, class Allocator>
+[[nodiscard]] ContentEncoding negotiate_encoding(http::request<Body, http::basic_fields<Allocator>> const& req, EncodingSet available) noexcept
+{
+    return negotiate_encoding(accept_encoding(req), available);
+}
+
+
+// Streaming compressor for a single content-coding
+class Compressor
+{
+public:
+    virtual ~Compressor();
+
+    // Compress `in`; the compressed bytes produced so far are appended to `out`
+    virtual void write(std::string_view in, ByteBuffer& out) = 0;
+
+    // Flush the remaining bytes and terminate the stream
+    virtual void finish(ByteBuffer& out) = 0;
+
+    // Make this compressor ready for a new stream
+    virtual void reset() = 0;
+};
+
+// Passed as a level to pick the encoder's own default / maximum level
+inline constexpr int default_compression_level = -1;
+inline constexpr int best_compression_level = 1 << 16;
+
+// Hint about the data. Each encoder maps it to its closest knob; the
+// names follow zlib, which has the most of them.
+enum class CompressionStrategy : std::uint8_t
+{
+    default_strategy, // zlib Z_DEFAULT_STRATEGY, brotli BROTLI_MODE_TEXT
+    filtered,         // zlib Z_FILTERED, brotli BROTLI_MODE_GENERIC
+    huffman_only,     // zlib Z_HUFFMAN_ONLY, brotli BROTLI_MODE_GENERIC, zstd ZSTD_fast
+    rle,              // zlib Z_RLE, brotli BROTLI_MODE_GENERIC, zstd ZSTD_fast
+    fixed,            // zlib Z_FIXED, brotli BROTLI_MODE_GENERIC
+};
+
+struct CompressionOptions
+{
+    int level = default_compression_level;
+    CompressionStrategy strategy = CompressionStrategy::default_strategy;
+
+    // Bodies smaller than this are sent as identity; the framing
+    // overhead outweighs the savings for tiny responses
+    std::size_t min_size = 0;
+};
+
+// Returns the compressor to the releasing thread's pool, reset for the
+// next stream, instead of destroying it
+struct PooledCompressorDeleter
+{
+    std::uint64_t registry_id = 0;
+    ContentEncoding encoding = ContentEncoding::identity;
+    int level = default_compression_level;
+    CompressionStrategy strategy = CompressionStrategy::default_strategy;
+
+    void operator()(Compressor* compressor) const noexcept;
+
+    bool operator==(PooledCompressorDeleter const&) const noexcept = default;
+};
+
+using PooledCompressor = std::unique_ptr<Compressor, PooledCompressorDeleter>;
+
+class EncoderRegistry
+{
+public:
+    using factory_type = std::function<std::unique_ptr<Compressor> (CompressionOptions const& options)>;
+
+    // Registers every encoder compiled into the library
+    EncoderRegistry();
+
+    // Not thread-safe; register custom encoders before the server starts
+    void add(ContentEncoding encoding, factory_type factory);
+
+    [[nodiscard]] EncodingSet available() const noexcept { return available_; }
+
+    [[nodiscard]] std::unique_ptr<Compressor> make(ContentEncoding encoding, CompressionOptions const& options = {}) const;
+
+    // A compressor from the calling thread's pool, or a new one.
+    // Contexts are only reused for the same coding, level and strategy.
+    [[nodiscard]] PooledCompressor acquire(ContentEncoding encoding, CompressionOptions const& options = {}) const;
+
+    // Compress a whole buffer at once
+    void compress(ContentEncoding encoding, std::string_view in, ByteBuffer& out, CompressionOptions const& options = {}) const;
+
+    template<class Body, class Allocator>
+    [[nodiscard]] ContentEncoding negotiate(http::request<Body, http::basic_fields<Allocator>> const& req) const noexcept
+    {
+        return negotiate_encoding(req, available_);
+    }
+
+private:
+    // Identifies the set of factories for pooling; changes on add()
+    std::uint64_t id_;
+
+    EncodingSet available_{ContentEncoding::identity};
+    std::array<factory_type, content_encoding_count_v> factories_;
+};
+
+}
+
+#endif
@@ -2,52 +2,36 @@
 #define VEIN_FILE_HPP
 
 #include "vein/LibraryConfig.hpp"
+#include "vein/MIME.hpp"
 
-#include <boost/locale/conversion.hpp>
-#include <boost/locale/generator.hpp>
-#include <boost/locale/util.hpp>
-
+#include <chrono>
 #include <filesystem>
+#include <optional>
 #include <string_view>
+#include <cstdint>
 
 
 namespace vein {
 
-struct [[nodiscard]] MIME
+struct FileInfo
 {
-    std::string_view type;
-    bool is_already_compressed = false;
+    std::uint64_t size = 0;
+    std::uint64_t inode = 0; // 0 where the platform has no such thing
+    std::int64_t mtime_ns = 0; // since the UNIX epoch
+
+    [[nodiscard]] std::chrono::sys_seconds last_modified() const noexcept
+    {
+        return std::chrono::floor<std::chrono::seconds>(std::chrono::sys_time<std::chrono::nanoseconds>{std::chrono::nanoseconds{mtime_ns}});
+    }
 };
 
-inline MIME mime_type(std::filesystem::path const& path)
-{
-    boost::locale::generator gen;
-    gen.locale_cache_enabled(true);
-    auto const loc = gen(boost::locale::util::get_system_locale(true));
-    auto const ext = boost::locale::to_lower(path.extension().string(), loc);
-
-    if (ext == ".htm")  return {"text/html; charset=utf-8"};
-    if (ext == ".html") return {"text/html; charset=utf-8"};
-    if (ext == ".php")  return {"text/html; charset=utf-8"};
-    if (ext == ".css")  return {"text/css; charset=utf-8"};
-    if (ext == ".txt")  return {"text/plain; charset=utf-8"};
-    if (ext == ".js")   return {"application/javascript; charset=utf-8"};
-    if (ext == ".json") return {"application/json; charset=utf-8"};
-    if (ext == ".xml")  return {"application/xml; charset=utf-8"};
-    if (ext == ".flv")  return {"video/x-flv", true};
-    if (ext == ".png")  return {"image/png", true};
-    if (ext == ".jpe")  return {"image/jpeg", true};
-    if (ext == ".jpeg") return {"image/jpeg", true};
-    if (ext == ".jpg")  return {"image/jpeg", true};
-    if (ext == ".gif")  return {"image/gif", true};
-    if (ext == ".bmp")  return {"image/bmp"};
-    if (ext == ".ico")  return {"image/vnd.microsoft.icon", true};
-    if (ext == ".tiff") return {"image/tiff", true};
-    if (ext == ".tif")  return {"image/tiff", true};
-    if (ext == ".svg")  return {"image/svg+xml"};
-    if (ext == ".svgz") return {"image/svg+xml"};
-    return {"application/text"};
-}
+// Metadata of a regular file, or nullopt if it does not exist / is not a regular file
+[[nodiscard]] std::optional<FileInfo> file_info(std::filesystem::path const& path);
+
+#ifndef BOOST_MSVC
+// Same as above, for an open file descriptor
+[[nodiscard]] std::optional<FileInfo> file_info(int fd);
+#endif
 
 }
 
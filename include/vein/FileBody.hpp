@@ -0,0 +1,185 @@
+﻿#ifndef VEIN_FILE_BODY_HPP
+#define VEIN_FILE_BODY_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+
+namespace vein {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = beast::net;
+
+// A response body made of regions of a file.
+//
+// Each region may be preceded by a few in-memory bytes, which is how
+// multipart/byteranges bodies are built. HTTPSession hands the regions to
+// sendfile(2) where available, so the file contents never go through
+// userspace. The writer below is the portable fallback which is used with
+// the regular Beast serializer.
+struct FileBody
+{
+    struct Segment
+    {
+        std::string head;
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+    };
+
+    class value_type
+    {
+    public:
+        void open(char const* path, beast::error_code& ec)
+        {
+            file_.open(path, beast::file_mode::read, ec);
+            if (ec) return;
+
+            file_size_ = file_.size(ec);
+            segments_.assign(1, Segment{{}, 0, file_size_});
+            tail_.clear();
+        }
+
+        [[nodiscard]] bool is_open() const noexcept { return file_.is_open(); }
+
+        // Restrict the body to [offset, offset + size)
+        void set_region(std::uint64_t offset, std::uint64_t size)
+        {
+            segments_.clear();
+            tail_.clear();
+            add_segment({}, offset, size);
+        }
+
+        void clear_segments() noexcept
+        {
+            segments_.clear();
+            tail_.clear();
+        }
+
+        void add_segment(std::string head, std::uint64_t offset, std::uint64_t size)
+        {
+            offset = std::min(offset, file_size_);
+            segments_.push_back({std::move(head), offset, std::min(size, file_size_ - offset)});
+        }
+
+        // Bytes sent after the last segment
+        void set_tail(std::string tail) { tail_ = std::move(tail); }
+
+        [[nodiscard]] beast::file& file() noexcept { return file_; }
+        [[nodiscard]] std::vector<Segment> const& segments() const noexcept { return segments_; }
+        [[nodiscard]] std::string const& tail() const noexcept { return tail_; }
+        [[nodiscard]] std::uint64_t file_size() const noexcept { return file_size_; }
+
+        [[nodiscard]] std::uint64_t size() const noexcept
+        {
+            std::uint64_t res = tail_.size();
+            for (auto const& segment : segments_) {
+                res += segment.head.size() + segment.size;
+            }
+            return res;
+        }
+
+    private:
+        beast::file file_;
+        std::uint64_t file_size_ = 0;
+        std::vector<Segment> segments_;
+        std::string tail_;
+    };
+
+    static std::uint64_t size(value_type const& body) noexcept
+    {
+        return body.size();
+    }
+
+    class writer
+    {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template<bool isRequest, class Fields>
+        writer(http::header<isRequest, Fields>&, value_type& body)
+            : body_(body)
+        {}
+
+        void init(beast::error_code& ec)
+        {
+            segment_ = 0;
+            head_done_ = false;
+            tail_done_ = false;
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>>
+        get(beast::error_code& ec)
+        {
+            ec = {};
+            auto const& segments = body_.segments();
+
+            while (segment_ < segments.size()) {
+                auto const& segment = segments[segment_];
+
+                if (!head_done_) {
+                    head_done_ = true;
+                    remain_ = segment.size;
+
+                    body_.file().seek(segment.offset, ec);
+                    if (ec) return boost::none;
+
+                    if (!segment.head.empty()) {
+                        return {{net::buffer(segment.head), true}};
+                    }
+                }
+
+                if (remain_ == 0) {
+                    ++segment_;
+                    head_done_ = false;
+                    continue;
+                }
+
+                auto const amount = static_cast<std::size_t>(std::min<std::uint64_t>(remain_, buf_.size()));
+                auto const n = body_.file().read(buf_.data(), amount, ec);
+                if (ec) return boost::none;
+
+                if (n == 0) {
+                    // the file was truncated while we were sending it
+                    ec = http::error::short_read;
+                    return boost::none;
+                }
+
+                remain_ -= n;
+                return {{const_buffers_type{buf_.data(), n}, true}};
+            }
+
+            if (!tail_done_ && !body_.tail().empty()) {
+                tail_done_ = true;
+                return {{net::buffer(body_.tail()), false}};
+            }
+            return boost::none;
+        }
+
+    private:
+        value_type& body_;
+        std::size_t segment_ = 0;
+        bool head_done_ = false;
+        bool tail_done_ = false;
+        std::uint64_t remain_ = 0;
+        std::array<char, 64 * 1024> buf_;
+    };
+};
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+﻿#ifndef VEIN_FILE_WATCHER_HPP
+#define VEIN_FILE_WATCHER_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <thread>
+#include <stop_token>
+
+
+namespace vein {
+
+// Watches a directory tree and reports every changed path on a
+// background thread. The reported path may be a directory, in which case
+// everything under it should be considered as changed.
+//
+// Change notification is currently implemented with inotify; on other
+// platforms the watcher never reports anything.
+class FileWatcher
+{
+public:
+    using callback_type = std::function<void (std::filesystem::path const&)>;
+
+    FileWatcher(std::filesystem::path const& root, callback_type callback);
+    ~FileWatcher();
+
+    FileWatcher(FileWatcher const&) = delete;
+    FileWatcher& operator=(FileWatcher const&) = delete;
+
+    [[nodiscard]] std::filesystem::path const& root() const noexcept { return root_; }
+
+private:
+    void add_watch_recursive(std::filesystem::path const& dir);
+    void run(std::stop_token stop_token);
+
+    std::filesystem::path root_;
+    callback_type callback_;
+
+#ifdef __linux__
+    int fd_ = -1;
+    std::unordered_map<int, std::filesystem::path> wd_path_;
+#endif
+
+    std::jthread thread_;
+};
+
+}
+
+#endif
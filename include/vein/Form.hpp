@@ -0,0 +1,65 @@
+﻿#ifndef VEIN_FORM_HPP
+#define VEIN_FORM_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace vein {
+
+// Fields of an application/x-www-form-urlencoded or multipart/form-data
+// request body. Everything is a view of the body, which must outlive the
+// form; urlencoded names and values are decoded on access, and only when
+// they contain escapes.
+class Form
+{
+public:
+    struct Field
+    {
+        std::string_view name;
+        std::string_view value;
+
+        // multipart only
+        std::string_view filename;
+        std::string_view content_type;
+
+        bool urlencoded = false;
+
+        [[nodiscard]] std::string decoded_name() const;
+        [[nodiscard]] std::string decoded_value() const;
+    };
+
+    Form() = default;
+
+    // Picks the parser by `content_type`; other types give an empty form.
+    // Throws std::invalid_argument on a malformed body.
+    [[nodiscard]] static Form parse(std::string_view content_type, std::string_view body);
+
+    [[nodiscard]] static Form parse_urlencoded(std::string_view body);
+    [[nodiscard]] static Form parse_multipart(std::string_view boundary, std::string_view body);
+
+    // The first field named `name`
+    [[nodiscard]] Field const* find(std::string_view name) const noexcept;
+
+    // Decoded value of the first field named `name`
+    [[nodiscard]] std::optional<std::string> get(std::string_view name) const;
+
+    [[nodiscard]] std::span<Field const> fields() const noexcept { return fields_; }
+    [[nodiscard]] bool empty() const noexcept { return fields_.empty(); }
+
+private:
+    std::vector<Field> fields_;
+};
+
+// `+` becomes a space and `%XX` the byte it encodes; malformed escapes
+// are kept as they are
+[[nodiscard]] std::string decode_form_component(std::string_view encoded);
+
+}
+
+#endif
@@ -2,21 +2,30 @@
 #define VEIN_HTTP_SESSION_HPP
 
 #include "vein/Error.hpp"
+#include "vein/RequestBody.hpp"
+#include "vein/Response.hpp"
 #include "vein/WebSocketSession.hpp"
 
 #include <boost/beast/websocket/rfc6455.hpp>
 #include <boost/beast/http/message_generator.hpp>
+#include <boost/beast/http/empty_body.hpp>
 #include <boost/beast/http/parser.hpp>
 #include <boost/beast/http/string_body.hpp>
 #include <boost/beast/http/read.hpp>
+#include <boost/beast/http/serializer.hpp>
+#include <boost/beast/http/write.hpp>
 #include <boost/beast/core/bind_handler.hpp>
 #include <boost/beast/core/tcp_stream.hpp>
 #include <boost/beast/core/flat_buffer.hpp>
 
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 
+#include <chrono>
 #include <queue>
+#include <optional>
+#include <cstdint>
 
 
 namespace vein {
@@ -62,34 +71,54 @@ private:
         do_read()
     {
         // Construct a new parser for each message
-        parser_.emplace();
+        header_parser_.emplace();
 
-        // Apply a reasonable limit to the allowed size
-        // of the body in bytes to prevent abuse.
-        parser_->body_limit(10000);
+        // The body limit depends on where the request goes,
+        // so it is applied once the header is known
+        header_parser_->body_limit(boost::none);
 
         // Set the timeout.
         stream_.expires_after(std::chrono::seconds(30));
 
-        // Read a request using the parser-oriented interface
-        http::async_read(
+        // Read the header only, using the parser-oriented interface
+        http::async_read_header(
             stream_,
             buffer_,
-            *parser_,
+            *header_parser_,
             beast::bind_front_handler(
-                &HTTPSession::on_read,
+                &HTTPSession::on_read_header,
                 shared_from_this()));
     }
 
+    // Applies the body limits of the target, then reads the body
+    void
+        on_read_header(beast::error_code ec, std::size_t bytes_transferred);
+
     void
         on_read(beast::error_code ec, std::size_t bytes_transferred);
 
+    // Returns true if `ec` ended the session
+    bool
+        handle_read_error(beast::error_code ec);
+
     void
-        queue_write(http::message_generator response)
+        queue_write(Response response)
     {
         // Allocate and store the work
         response_queue_.push(std::move(response));
 
+        // Deferred responses are resolved in place; the queue never
+        // moves its elements
+        if (auto* deferred = response_queue_.back().deferred()) {
+            // moved out first, since the handler replaces the response
+            auto start = std::move(deferred->start);
+            start(
+                stream_.get_executor(),
+                [self = shared_from_this(), &queued = response_queue_.back()](Response res) {
+                    self->on_deferred(queued, std::move(res));
+                });
+        }
+
         // If there was no previous work, start the write loop
         if (response_queue_.size() == 1)
             do_write();
@@ -101,11 +130,20 @@ private:
         do_write()
     {
         if (!response_queue_.empty()) {
-            bool keep_alive = response_queue_.front().keep_alive();
+            auto& response = response_queue_.front();
+            if (response.deferred()) {
+                return; // resumed by on_deferred()
+            }
+
+            bool keep_alive = response.keep_alive();
+
+            if (auto* file_response = response.file()) {
+                return do_write_file(*file_response, keep_alive);
+            }
 
             beast::async_write(
                 stream_,
-                std::move(response_queue_.front()),
+                std::move(*response.generator()),
                 beast::bind_front_handler(
                     &HTTPSession::on_write,
                     shared_from_this(),
@@ -113,6 +151,53 @@ private:
         }
     }
 
+    void
+        on_deferred(Response& queued, Response response)
+    {
+        queued = std::move(response);
+
+        // Responses are written in order; later ones wait for the front
+        if (&queued == &response_queue_.front())
+            do_write();
+    }
+
+    // Writes the header with Beast and lets the kernel copy the body
+    // straight from the page cache to the socket
+    void
+        do_write_file(FileResponse& res, bool keep_alive);
+
+#ifdef __linux__
+    void
+        on_write_file_header(
+            bool keep_alive,
+            beast::error_code ec,
+            std::size_t bytes_transferred);
+
+    // Sends the in-memory head of the current segment, then its file region
+    void
+        do_write_segment(bool keep_alive);
+
+    void
+        on_write_segment_head(
+            bool keep_alive,
+            beast::error_code ec,
+            std::size_t bytes_transferred);
+
+    void
+        do_sendfile(bool keep_alive, beast::error_code ec = {});
+
+    // Closes the socket if it stayed unwritable for sendfile_idle_timeout,
+    // which makes the pending wait fail
+    void
+        on_sendfile_timeout(beast::error_code ec);
+
+    void
+        on_write_file(
+            bool keep_alive,
+            beast::error_code ec,
+            std::size_t bytes_transferred);
+#endif
+
     void
         on_write(
             bool keep_alive,
@@ -154,11 +239,24 @@ private:
     Router* router_ = nullptr;
 
     static constexpr std::size_t queue_limit = 8; // max responses
-    std::queue<http::message_generator> response_queue_;
-
-    // The parser is stored in an optional container so we can
-    // construct it from scratch it at the beginning of each new message.
-    boost::optional<http::request_parser<http::string_body>> parser_;
+    std::queue<Response> response_queue_;
+
+    std::optional<http::response_serializer<FileBody>> file_serializer_;
+    std::size_t sendfile_segment_ = 0;
+    std::uint64_t sendfile_offset_ = 0;
+    std::uint64_t sendfile_remain_ = 0;
+
+    // The raw socket waits of the sendfile loop bypass the tcp_stream
+    // timeout, so a client which stops reading is dropped by this timer
+    static constexpr std::chrono::seconds sendfile_idle_timeout{30};
+    net::steady_timer sendfile_timer_{stream_.get_executor()};
+    bool sendfile_waiting_ = false;
+
+    // The parsers are stored in an optional container so we can
+    // construct them from scratch at the beginning of each new message.
+    // The body parser is moved from the header parser.
+    boost::optional<http::request_parser<http::empty_body>> header_parser_;
+    boost::optional<http::request_parser<RequestBody>> parser_;
 
 };
 
@@ -7,6 +7,7 @@
 #include <boost/beast/core/error.hpp>
 #include <boost/beast/core/bind_handler.hpp>
 
+#include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
 
@@ -22,15 +23,27 @@ using tcp = boost::asio::ip::tcp;
 
 class Router;
 
+struct ListenerOptions
+{
+    // Bind with SO_REUSEPORT, so that one listener per io_context can
+    // share the port and the kernel spreads the connections among them
+    bool reuse_port = false;
+
+    // Needed when the io_context is run by more than one thread
+    bool strand_per_session = true;
+};
+
 // Accepts incoming connections and launches the sessions
 class Listener : public std::enable_shared_from_this<Listener>
 {
     net::io_context& ioc_;
+    ListenerOptions options_;
     tcp::acceptor acceptor_;
     std::shared_ptr<std::string const> doc_root_;
 
 public:
-    Listener(net::io_context& ioc, tcp::endpoint endpoint, std::unique_ptr<Router> router);
+    // `router` must outlive the listener and its sessions
+    Listener(net::io_context& ioc, tcp::endpoint endpoint, Router* router, ListenerOptions const& options = {});
     ~Listener();
 
     // Start accepting incoming connections
@@ -48,11 +61,21 @@ public:
     }
 
 private:
+    // A strand of the io_context, or the io_context itself if it is
+    // only run by one thread
+    [[nodiscard]] net::any_io_executor make_executor() const
+    {
+        if (options_.strand_per_session) {
+            return net::make_strand(ioc_);
+        }
+        return ioc_.get_executor();
+    }
+
     void do_accept()
     {
-        // The new connection gets its own strand
+        // The new connection gets its own strand, if needed
         acceptor_.async_accept(
-            net::make_strand(ioc_),
+            make_executor(),
             beast::bind_front_handler(
                 &Listener::on_accept,
                 shared_from_this()));
@@ -60,7 +83,7 @@ private:
 
     void on_accept(beast::error_code ec, tcp::socket socket);
 
-    std::unique_ptr<Router> router_;
+    Router* router_ = nullptr;
 };
 
 }
@@ -0,0 +1,41 @@
+﻿#ifndef VEIN_MIME_HPP
+#define VEIN_MIME_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <filesystem>
+#include <string_view>
+
+
+namespace vein {
+
+struct [[nodiscard]] MIME
+{
+    std::string_view type;
+    bool is_already_compressed = false;
+};
+
+// Looks up a file extension ("js", "PNG"; the leading dot is optional).
+// ASCII case-insensitive; never allocates.
+MIME mime_type_for_extension(std::string_view extension) noexcept;
+
+MIME mime_type(std::filesystem::path const& path) noexcept;
+
+// Register or override an extension. The strings are copied, and the
+// returned views stay valid for the lifetime of the process.
+// Not thread-safe; extend the table before the server starts.
+void add_mime_type(std::string_view extension, std::string_view type, bool is_already_compressed);
+
+// Same as above, guessing `is_already_compressed` from the type
+void add_mime_type(std::string_view extension, std::string_view type);
+
+// Loads a mime.types file as shipped by Apache / nginx / most distributions:
+// "type/subtype ext1 ext2 ..." per line, with "#" comments. Textual types
+// get "; charset=utf-8" like the built-in ones.
+// Returns the number of extensions registered.
+// Not thread-safe; extend the table before the server starts.
+std::size_t load_mime_types(std::filesystem::path const& path);
+
+}
+
+#endif
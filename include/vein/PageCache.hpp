@@ -0,0 +1,201 @@
+﻿#ifndef VEIN_PAGE_CACHE_HPP
+#define VEIN_PAGE_CACHE_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/ByteBuffer.hpp"
+#include "vein/Encoding.hpp"
+
+#include <boost/beast/http/message.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <cstdint>
+
+
+namespace vein {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Opt-in per controller; see Controller::set_page_cache_options
+struct PageCacheOptions
+{
+    std::chrono::steady_clock::duration ttl = std::chrono::seconds{60};
+
+    // Request fields the page depends on besides the URL, e.g. "Cookie".
+    // Accept-Encoding is always part of the key.
+    std::vector<std::string> vary;
+
+    // Concurrent misses for the same key wait for a single render
+    bool coalesce = true;
+
+    // How long an expired page is still served while one request refreshes
+    // it in the background. Needs Router::set_background_executor().
+    std::chrono::steady_clock::duration stale_while_revalidate{};
+};
+
+// Bounded cache of final controller responses (header and possibly
+// compressed body), keyed by request-target, content-coding and the
+// values of the fields listed in PageCacheOptions::vary.
+//
+// Like StaticCache, lookups only take a shared lock and eviction is
+// CLOCK; entries past their stale period are evicted before anything else.
+class PageCache
+{
+public:
+    static constexpr std::size_t default_byte_budget = 32 * 1024 * 1024;
+
+    using clock_type = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        http::response_header<> header;
+        ByteBuffer body;
+        clock_type::time_point expires;
+
+        // served stale until this, if later than `expires`
+        clock_type::time_point stale_expires;
+
+        // set by the one request which starts the background refresh
+        mutable std::atomic<bool> refreshing{false};
+
+        [[nodiscard]] bool is_fresh(clock_type::time_point now) const noexcept { return now < expires; }
+    };
+
+    using EntryPtr = std::shared_ptr<Entry const>;
+
+private:
+    struct FlightState
+    {
+        std::mutex mtx;
+        bool done = false;
+        EntryPtr entry;
+        std::vector<std::function<void(EntryPtr)>> waiters;
+    };
+
+public:
+    // Result of the render another request is running
+    class FlightResult
+    {
+    public:
+        // `handler` gets the entry, or null if that response could not be
+        // shared. It runs on the thread which completes the flight, or
+        // right away if it is already complete; nothing blocks.
+        void on_complete(std::function<void(EntryPtr)> handler) const;
+
+    private:
+        friend PageCache;
+
+        explicit FlightResult(std::shared_ptr<FlightState> state) noexcept
+            : state_(std::move(state))
+        {}
+
+        std::shared_ptr<FlightState> state_;
+    };
+
+    // Held by the one request rendering a key while others wait for it
+    class Flight
+    {
+    public:
+        Flight(Flight&& other) noexcept
+            : cache_(std::exchange(other.cache_, nullptr))
+            , key_(std::move(other.key_))
+            , state_(std::move(other.state_))
+        {}
+
+        Flight& operator=(Flight&&) = delete;
+
+        // a failed render releases the waiters too
+        ~Flight() { complete(nullptr); }
+
+        // Insert the entry into the cache before calling this
+        void complete(EntryPtr entry) noexcept;
+
+    private:
+        friend PageCache;
+
+        Flight(PageCache& cache, std::string key)
+            : cache_(&cache)
+            , key_(std::move(key))
+        {}
+
+        PageCache* cache_;
+        std::string key_;
+        std::shared_ptr<FlightState> state_ = std::make_shared<FlightState>();
+    };
+
+    explicit PageCache(std::size_t byte_budget = default_byte_budget)
+        : byte_budget_(byte_budget)
+    {}
+
+    // The key starts with the request-target, so that invalidate() can
+    // match it by prefix; the rest is opaque
+    [[nodiscard]] static std::string make_key(std::string_view target, ContentEncoding encoding);
+    static void append_vary_value(std::string& key, std::string_view value);
+
+    // null if missing or expired; stale entries are returned, check Entry::is_fresh
+    [[nodiscard]] EntryPtr find(std::string_view key) const;
+
+    // Singleflight: the first caller for `key` gets the Flight and renders,
+    // the others get its pending result, which completes asynchronously
+    [[nodiscard]] std::variant<Flight, FlightResult> join_flight(std::string_view key);
+
+    // `generation` must be the value of `generation()` observed before the
+    // page was rendered; entries racing with an invalidation are dropped.
+    // Returns false if the entry was dropped, or is too large to be kept.
+    bool insert(std::string key, EntryPtr entry, std::uint64_t generation);
+
+    // Drop every page whose request-target starts with `target_prefix`,
+    // e.g. "/blog/" after a post was edited
+    void invalidate(std::string_view target_prefix);
+
+    void clear();
+
+    [[nodiscard]] std::uint64_t generation() const noexcept { return generation_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] std::size_t byte_budget() const;
+    void set_byte_budget(std::size_t byte_budget);
+
+    [[nodiscard]] std::size_t bytes_used() const;
+
+private:
+    struct StringHash
+    {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+    };
+
+    struct Slot
+    {
+        EntryPtr entry;
+        std::size_t size = 0;
+        mutable std::atomic<bool> referenced{false};
+    };
+
+    [[nodiscard]] static std::size_t entry_size(std::string_view key, Entry const& entry) noexcept;
+
+    void evict_locked(std::size_t incoming);
+
+    std::mutex flight_mtx_;
+    std::unordered_map<std::string, std::shared_ptr<FlightState>, StringHash, std::equal_to<>> flights_;
+
+    mutable std::shared_mutex mtx_;
+    std::unordered_map<std::string, Slot, StringHash, std::equal_to<>> entries_;
+    std::size_t byte_budget_ = default_byte_budget;
+    std::size_t bytes_used_ = 0;
+    std::atomic<std::uint64_t> generation_{0};
+};
+
+}
+
+#endif
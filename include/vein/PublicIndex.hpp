@@ -0,0 +1,92 @@
+﻿#ifndef VEIN_PUBLIC_INDEX_HPP
+#define VEIN_PUBLIC_INDEX_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/File.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+namespace vein {
+
+// Metadata of every regular file under public_root, keyed by the
+// '/'-separated path relative to the root ("css/app.css").
+//
+// The index is built once at startup and kept up to date by Router's
+// FileWatcher, so the static file path can check existence, traversal
+// safety and freshness without any syscall. Only files whose canonical
+// path stays under the root are ever indexed.
+//
+// Paths which are not indexed yet (e.g. reached through a relative symlink
+// to a directory, or created a moment ago) are resolved with
+// openat2(RESOLVE_BENEATH) relative to the root and then added.
+class PublicIndex
+{
+public:
+    struct Entry
+    {
+        std::filesystem::path path; // canonical
+        FileInfo info;
+        MIME mime;
+    };
+
+    using EntryPtr = std::shared_ptr<Entry const>;
+
+    explicit PublicIndex(std::filesystem::path const& root);
+    ~PublicIndex();
+
+    PublicIndex(PublicIndex const&) = delete;
+    PublicIndex& operator=(PublicIndex const&) = delete;
+
+    [[nodiscard]] std::filesystem::path const& root() const noexcept { return root_; }
+
+    // Never touches the filesystem
+    [[nodiscard]] EntryPtr find(std::string_view rel_path) const;
+
+    // find(), falling back to the filesystem for paths not indexed yet
+    [[nodiscard]] EntryPtr resolve(std::string_view rel_path);
+
+    // Re-examine `path` and, if it is a directory, everything under it.
+    // Called with the paths reported by FileWatcher.
+    void refresh(std::filesystem::path const& path);
+
+    void rebuild();
+
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    struct StringHash
+    {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+    };
+
+    using Entries = std::unordered_map<std::string, EntryPtr, StringHash, std::equal_to<>>;
+
+    // nullopt if `path` is not under the root
+    [[nodiscard]] std::optional<std::string> key_of(std::filesystem::path const& path) const;
+
+    [[nodiscard]] EntryPtr make_entry(std::filesystem::path const& path) const;
+    [[nodiscard]] EntryPtr open_beneath(std::string_view rel_path) const;
+
+    void scan(std::filesystem::path const& dir, Entries& entries) const;
+
+    std::filesystem::path root_;
+
+#ifdef __linux__
+    int root_fd_ = -1;
+#endif
+
+    mutable std::shared_mutex mtx_;
+    Entries entries_;
+};
+
+}
+
+#endif
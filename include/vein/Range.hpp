@@ -0,0 +1,47 @@
+﻿#ifndef VEIN_RANGE_HPP
+#define VEIN_RANGE_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/FileBody.hpp"
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+
+namespace vein {
+
+// Inclusive byte positions within a representation
+struct ByteRange
+{
+    std::uint64_t first = 0;
+    std::uint64_t last = 0;
+
+    [[nodiscard]] constexpr std::uint64_t size() const noexcept { return last - first + 1; }
+};
+
+// Requests asking for more ranges than this are served in full
+inline constexpr std::size_t max_byte_ranges = 16;
+
+// Parses a `Range` field value (RFC 9110 14.1.2) against a representation
+// of `size` bytes. Overlapping and adjacent ranges are coalesced.
+//
+// nullopt: the field is malformed or not worth honoring; send 200 with the
+//          whole representation
+// empty:   none of the ranges is satisfiable; send 416
+[[nodiscard]] std::optional<std::vector<ByteRange>> parse_byte_ranges(std::string_view field_value, std::uint64_t size);
+
+// "bytes 0-499/1234"
+[[nodiscard]] std::string content_range(ByteRange const& range, std::uint64_t size);
+
+// Lays out a multipart/byteranges body (RFC 9110 14.6) over the file
+// already opened in `body`. Returns the `Content-Type` field value,
+// which carries the boundary.
+std::string set_byteranges(FileBody::value_type& body, std::span<ByteRange const> ranges, std::string_view content_type);
+
+}
+
+#endif
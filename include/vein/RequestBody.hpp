@@ -0,0 +1,126 @@
+﻿#ifndef VEIN_REQUEST_BODY_HPP
+#define VEIN_REQUEST_BODY_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <boost/beast/core/buffers_range.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/file_stdio.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+
+namespace vein {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+struct RequestBodyOptions
+{
+    // Larger bodies are refused with 413 Content Too Large
+    std::uint64_t limit = 1024 * 1024;
+
+    // Larger bodies are spilled to a temporary file instead of being
+    // buffered in memory
+    std::size_t memory_limit = 64 * 1024;
+};
+
+// Body of an incoming request which is buffered in memory up to a limit,
+// and streamed to an anonymous temporary file past it. A body whose
+// Content-Length is already over the limit goes to the file from the start.
+struct RequestBody
+{
+    class reader;
+
+    class value_type
+    {
+    public:
+        value_type() = default;
+        value_type(value_type&&) noexcept = default;
+        value_type& operator=(value_type&&) noexcept = default;
+        ~value_type();
+
+        void set_memory_limit(std::size_t limit) noexcept { memory_limit_ = limit; }
+
+        [[nodiscard]] std::uint64_t size() const noexcept { return size_; }
+        [[nodiscard]] bool spilled() const noexcept { return file_.is_open(); }
+
+        // The whole body. The file of a spilled body is mapped into memory
+        // on the first call, or read into it where mapping is unsupported.
+        [[nodiscard]] std::string_view view() const;
+
+        // The temporary file of a spilled body; it is deleted with the body
+        [[nodiscard]] beast::file_stdio const& file() const noexcept { return file_; }
+
+    private:
+        friend reader;
+
+        void reserve(std::uint64_t size, beast::error_code& ec);
+        void append(char const* data, std::size_t size, beast::error_code& ec);
+        void spill(beast::error_code& ec);
+
+        std::size_t memory_limit_ = RequestBodyOptions{}.memory_limit;
+        std::string memory_;
+        mutable beast::file_stdio file_; // read by view()
+        std::uint64_t size_ = 0;
+
+#ifdef __linux__
+        struct Unmap
+        {
+            std::size_t size;
+            void operator()(char* p) const noexcept;
+        };
+        mutable std::unique_ptr<char, Unmap> mapping_;
+#else
+        mutable std::string loaded_;
+#endif
+    };
+
+    class reader
+    {
+    public:
+        template<bool isRequest, class Fields>
+        reader(http::header<isRequest, Fields>&, value_type& body) noexcept
+            : body_(body)
+        {}
+
+        void init(boost::optional<std::uint64_t> const& content_length, beast::error_code& ec)
+        {
+            ec = {};
+            if (content_length) {
+                body_.reserve(*content_length, ec);
+            }
+        }
+
+        template<class ConstBufferSequence>
+        std::size_t put(ConstBufferSequence const& buffers, beast::error_code& ec)
+        {
+            ec = {};
+            std::size_t n = 0;
+            for (auto const buffer : beast::buffers_range_ref(buffers)) {
+                body_.append(static_cast<char const*>(buffer.data()), buffer.size(), ec);
+                if (ec) return n;
+                n += buffer.size();
+            }
+            return n;
+        }
+
+        void finish(beast::error_code& ec) noexcept
+        {
+            ec = {};
+        }
+
+    private:
+        value_type& body_;
+    };
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+﻿#ifndef VEIN_RESPONSE_HPP
+#define VEIN_RESPONSE_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/FileBody.hpp"
+
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/message_generator.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+
+#include <functional>
+#include <type_traits>
+#include <variant>
+#include <utility>
+
+
+namespace vein {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+namespace net = boost::asio;
+
+using FileResponse = http::response<FileBody>;
+
+class Response;
+
+// A response which is not ready yet, such as a page another request is
+// rendering. The session calls `start` once, with its own executor;
+// the handler must be invoked exactly once, on that executor.
+struct DeferredResponse
+{
+    using handler_type = std::function<void(Response)>;
+
+    std::function<void(net::any_io_executor, handler_type)> start;
+    bool keep_alive = true;
+};
+
+// A response produced by Router. File responses are kept apart from the
+// type-erased messages so that HTTPSession can send their body with
+// sendfile(2) instead of the Beast serializer.
+class Response
+{
+public:
+    Response(http::message_generator&& generator)
+        : value_(std::move(generator))
+    {}
+
+    Response(FileResponse&& res)
+        : value_(std::in_place_type<FileResponse>, std::move(res))
+    {}
+
+    Response(DeferredResponse&& deferred)
+        : value_(std::move(deferred))
+    {}
+
+    template<bool isRequest, class Body, class Fields>
+    Response(http::message<isRequest, Body, Fields>&& msg)
+        : value_(std::in_place_type<http::message_generator>, std::move(msg))
+    {}
+
+    [[nodiscard]] bool keep_alive() noexcept
+    {
+        return std::visit([](auto& v) {
+            if constexpr (std::is_same_v<std::remove_cvref_t<decltype(v)>, DeferredResponse>) {
+                return v.keep_alive;
+            } else {
+                return v.keep_alive();
+            }
+        }, value_);
+    }
+
+    [[nodiscard]] http::message_generator* generator() noexcept { return std::get_if<http::message_generator>(&value_); }
+    [[nodiscard]] FileResponse* file() noexcept { return std::get_if<FileResponse>(&value_); }
+    [[nodiscard]] DeferredResponse* deferred() noexcept { return std::get_if<DeferredResponse>(&value_); }
+
+private:
+    std::variant<http::message_generator, FileResponse, DeferredResponse> value_;
+};
+
+}
+
+#endif
@@ -0,0 +1,271 @@
+﻿#ifndef VEIN_ROUTE_TABLE_HPP
+#define VEIN_ROUTE_TABLE_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <sg14/inplace_vector.h>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace vein {
+
+// Path parameters captured by a route. Names refer to the route table and
+// values to the path that was matched, so neither is copied.
+class RouteParams
+{
+public:
+    static constexpr std::size_t capacity = 8;
+
+    using value_type = std::pair<std::string_view, std::string_view>;
+
+    // empty if `name` was not captured; `*` is the rest of a wildcard route
+    [[nodiscard]] std::string_view operator[](std::string_view name) const noexcept
+    {
+        auto const it = std::ranges::find(params_, name, &value_type::first);
+        return it == params_.end() ? std::string_view{} : it->second;
+    }
+
+    [[nodiscard]] bool contains(std::string_view name) const noexcept
+    {
+        return std::ranges::find(params_, name, &value_type::first) != params_.end();
+    }
+
+    [[nodiscard]] auto begin() const noexcept { return params_.begin(); }
+    [[nodiscard]] auto end() const noexcept { return params_.end(); }
+    [[nodiscard]] std::size_t size() const noexcept { return params_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return params_.empty(); }
+
+    void push_back(std::string_view name, std::string_view value) { params_.emplace_back(name, value); }
+    void resize(std::size_t size) { params_.resize(size); }
+
+private:
+    sg14::inplace_vector<value_type, capacity> params_;
+};
+
+// RouteParams with values of its own, for work which outlives the path
+// they were captured from. Names still refer to the route table.
+class OwnedRouteParams
+{
+public:
+    OwnedRouteParams() = default;
+
+    explicit OwnedRouteParams(RouteParams const& params)
+    {
+        std::size_t size = 0;
+        for (auto const& [_, value] : params) size += value.size();
+
+        // on the heap, so the views survive moves
+        values_ = std::make_unique_for_overwrite<char[]>(size);
+
+        auto* p = values_.get();
+        for (auto const& [name, value] : params) {
+            std::ranges::copy(value, p);
+            params_.push_back(name, {p, value.size()});
+            p += value.size();
+        }
+    }
+
+    [[nodiscard]] RouteParams const& get() const noexcept { return params_; }
+
+private:
+    std::unique_ptr<char[]> values_;
+    RouteParams params_;
+};
+
+// Maps path patterns to values with a compressed radix tree. A pattern is
+// literal text with two kinds of placeholders:
+//
+//   /user/{id}       `{name}` is one whole, non-empty path segment
+//   /static/*        a trailing `*` is the rest of the path, possibly empty
+//
+// Literal text is preferred over a parameter, and a parameter over a
+// wildcard, backtracking when the preferred branch does not lead to a route.
+// Matching does not allocate.
+template<class T>
+class RouteTable
+{
+public:
+    struct Match
+    {
+        T const* value = nullptr;
+        RouteParams params;
+
+        explicit operator bool() const noexcept { return value != nullptr; }
+    };
+
+    // Throws std::invalid_argument on a malformed pattern, or if the
+    // pattern is already routed
+    void insert(std::string_view pattern, T value)
+    {
+        std::string const full{pattern};
+
+        if (!pattern.starts_with('/')) {
+            throw std::invalid_argument{"route pattern must start with '/': " + full};
+        }
+
+        Node* node = &root_;
+        std::size_t param_count = 0;
+
+        while (!pattern.empty()) {
+            auto const special = pattern.find_first_of("{*");
+            node = insert_literal(*node, pattern.substr(0, special));
+            if (special == std::string_view::npos) break;
+
+            if (pattern[special - 1] != '/') {
+                throw std::invalid_argument{"route placeholder must start a path segment: " + full};
+            }
+
+            if (pattern[special] == '*') {
+                if (special + 1 != pattern.size()) {
+                    throw std::invalid_argument{"'*' must end the route pattern: " + full};
+                }
+                if (node->wildcard) {
+                    throw std::invalid_argument{"route is already defined: " + full};
+                }
+                node->wildcard.emplace(std::move(value));
+                return;
+            }
+
+            auto const close = pattern.find('}', special);
+            if (close == std::string_view::npos) {
+                throw std::invalid_argument{"unterminated route parameter: " + full};
+            }
+            if (close + 1 != pattern.size() && pattern[close + 1] != '/') {
+                throw std::invalid_argument{"route parameter must end a path segment: " + full};
+            }
+            if (++param_count > RouteParams::capacity - 1) { // leave room for `*`
+                throw std::invalid_argument{"too many route parameters: " + full};
+            }
+
+            auto const name = pattern.substr(special + 1, close - special - 1);
+            if (name.empty() || name == "*") {
+                throw std::invalid_argument{"invalid route parameter name: " + full};
+            }
+
+            if (!node->param) {
+                node->param = std::make_unique<Node>();
+                node->param->param_name = name;
+            } else if (node->param->param_name != name) {
+                throw std::invalid_argument{"route parameter conflicts with {" + node->param->param_name + "}: " + full};
+            }
+            node = node->param.get();
+            pattern.remove_prefix(close + 1);
+        }
+
+        if (node->value) {
+            throw std::invalid_argument{"route is already defined: " + full};
+        }
+        node->value.emplace(std::move(value));
+    }
+
+    [[nodiscard]] Match match(std::string_view path) const
+    {
+        Match m;
+        m.value = match(root_, path, m.params);
+        return m;
+    }
+
+private:
+    struct Node
+    {
+        // label of the edge leading here; empty for the root and parameters
+        std::string prefix;
+
+        // literal edges, each starting with a different character
+        std::vector<std::unique_ptr<Node>> children;
+
+        // `{name}` edge; its node holds the name
+        std::unique_ptr<Node> param;
+        std::string param_name;
+
+        std::optional<T> value;
+        std::optional<T> wildcard; // `*` right after this node
+    };
+
+    [[nodiscard]] static Node* insert_literal(Node& node, std::string_view text)
+    {
+        Node* current = &node;
+
+        while (!text.empty()) {
+            auto const it = std::ranges::find_if(current->children, [&](auto const& child) {
+                return child->prefix.front() == text.front();
+            });
+
+            if (it == current->children.end()) {
+                auto& child = current->children.emplace_back(std::make_unique<Node>());
+                child->prefix = text;
+                return child.get();
+            }
+
+            auto& child = *it;
+            auto const common = static_cast<std::size_t>(
+                std::ranges::mismatch(child->prefix, text).in1 - child->prefix.begin()
+            );
+
+            if (common < child->prefix.size()) {
+                // split the edge at the first difference
+                auto middle = std::make_unique<Node>();
+                middle->prefix = child->prefix.substr(0, common);
+                child->prefix.erase(0, common);
+                middle->children.emplace_back(std::move(child));
+                child = std::move(middle);
+            }
+
+            current = child.get();
+            text.remove_prefix(common);
+        }
+        return current;
+    }
+
+    [[nodiscard]] static T const* match(Node const& node, std::string_view path, RouteParams& params)
+    {
+        if (path.empty() && node.value) {
+            return &*node.value;
+        }
+
+        if (!path.empty()) {
+            for (auto const& child : node.children) {
+                if (child->prefix.front() != path.front()) continue;
+
+                if (path.starts_with(child->prefix)) {
+                    if (auto const* value = match(*child, path.substr(child->prefix.size()), params)) {
+                        return value;
+                    }
+                }
+                break;
+            }
+        }
+
+        if (node.param) {
+            auto const segment = path.substr(0, path.find('/'));
+            if (!segment.empty()) {
+                auto const size = params.size();
+                params.push_back(node.param->param_name, segment);
+                if (auto const* value = match(*node.param, path.substr(segment.size()), params)) {
+                    return value;
+                }
+                params.resize(size);
+            }
+        }
+
+        if (node.wildcard) {
+            params.push_back("*", path);
+            return &*node.wildcard;
+        }
+        return nullptr;
+    }
+
+    Node root_;
+};
+
+}
+
+#endif
@@ -3,7 +3,19 @@
 
 #include "vein/LibraryConfig.hpp"
 #include "vein/Controller.hpp"
+#include "vein/Encoding.hpp"
 #include "vein/File.hpp"
+#include "vein/FileBody.hpp"
+#include "vein/FileWatcher.hpp"
+#include "vein/PageCache.hpp"
+#include "vein/PublicIndex.hpp"
+#include "vein/Range.hpp"
+#include "vein/RequestBody.hpp"
+#include "vein/Response.hpp"
+#include "vein/RouteTable.hpp"
+#include "vein/SharedBody.hpp"
+#include "vein/StaticCache.hpp"
+#include "vein/Validators.hpp"
 
 #include "yk/allocator/default_init_allocator.hpp"
 
@@ -13,13 +25,11 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/http/vector_body.hpp>
 
-#include <boost/iostreams/filter/gzip.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/device/file.hpp>
-#include <boost/iostreams/copy.hpp>
-
+#include <array>
 #include <filesystem>
+#include <format>
 #include <fstream>
+#include <optional>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -29,6 +39,7 @@ namespace vein {
 
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace net = beast::net;
 
 using PathMatcher = std::string;
 
@@ -78,26 +89,57 @@ public:
         canonical_url_origin_ = canonical_url_origin;
     }
 
+    // Serves paths matching `matcher` with `controller`; see RouteTable for
+    // the syntax. Patterns are matched against the decoded path, so they are
+    // written as plain text and "%2F" in a request counts as a "/"; the
+    // controller reads the decoded captures with Controller::params().
     void route(PathMatcher matcher, std::unique_ptr<Controller> controller);
+    void route(PathMatcher matcher, std::unique_ptr<Controller> controller, CompressionOptions const& compression);
 
-    [[nodiscard]] static bool is_safe_path(std::filesystem::path root, std::filesystem::path child)
-    {
-        if (!exists(root)) return false;
-        if (!exists(child)) return false;
+    // Limits for reading the body of a request with this header: those
+    // of the controller it is routed to, or a small default otherwise
+    [[nodiscard]] RequestBodyOptions request_body_options(http::request_header<> const& header) const;
 
-        root = canonical(root);
-        child = canonical(child);
+    // Options for static files whose path relative to public_root starts
+    // with `prefix`; the longest matching prefix wins. The default for ""
+    // is the best level, since compressed files are cached.
+    void set_static_compression_options(std::string prefix, CompressionOptions const& options);
+    [[nodiscard]] CompressionOptions const& static_compression_options(std::string_view rel_path) const noexcept;
 
-        auto const it = std::search(child.begin(), child.end(), root.begin(), root.end());
-        return it == child.begin();
-    }
+    // Encoders shared by static files and controllers
+    [[nodiscard]] EncoderRegistry& encoders() noexcept { return encoders_; }
+    [[nodiscard]] EncoderRegistry const& encoders() const noexcept { return encoders_; }
+
+    [[nodiscard]] StaticCache& static_cache() noexcept { return static_cache_; }
+    [[nodiscard]] StaticCache const& static_cache() const noexcept { return static_cache_; }
+
+    // Where stale-while-revalidate refreshes of cached pages run; set by
+    // Server to its io_context. Without one, stale pages are re-rendered in place.
+    void set_background_executor(net::any_io_executor executor) { background_executor_ = std::move(executor); }
+    [[nodiscard]] std::optional<net::any_io_executor> const& background_executor() const noexcept { return background_executor_; }
+
+    // Responses of controllers with page caching enabled. Thread-safe;
+    // call page_cache().invalidate(prefix) when the underlying data changes.
+    [[nodiscard]] PageCache& page_cache() noexcept { return page_cache_; }
+    [[nodiscard]] PageCache const& page_cache() const noexcept { return page_cache_; }
+
+    // null if public_root does not exist
+    [[nodiscard]] PublicIndex* public_index() noexcept { return public_index_.get(); }
+    [[nodiscard]] PublicIndex const* public_index() const noexcept { return public_index_.get(); }
+
+    // Write "foo.js.br", "foo.js.zst" and "foo.js.gz" next to every
+    // compressible file under public_root, with its static compression options.
+    // Sidecars which are up to date are left untouched.
+    // Returns the number of sidecars written.
+    std::size_t precompress_public_root() const;
 
     // Return a response for the given request.
     //
     // The concrete type of the response message (which depends on the
-    // request), is type-erased in message_generator.
+    // request), is type-erased in message_generator, except for file
+    // responses which are sent with sendfile(2).
     template <class Body, class Allocator>
-    http::message_generator handle_request(http::request<Body, http::basic_fields<Allocator>>&& req)
+    Response handle_request(http::request<Body, http::basic_fields<Allocator>>&& req)
     {
         // Returns a bad request response
         auto const bad_request = [&req](beast::string_view why) {
@@ -132,9 +174,22 @@ public:
             return res;
         };
 
+        // Returns a method not allowed response, for bodies sent to files
+        auto const method_not_allowed = [&req]() {
+            http::response<http::empty_body> res{http::status::method_not_allowed, req.version()};
+            //res.set(http::field::server, "vein");
+            res.set(http::field::allow, "GET, HEAD");
+            res.keep_alive(req.keep_alive());
+            res.content_length(0);
+            return res;
+        };
+
         // Make sure we can handle the method
         if (req.method() != http::verb::get &&
-            req.method() != http::verb::head
+            req.method() != http::verb::head &&
+            req.method() != http::verb::post &&
+            req.method() != http::verb::put &&
+            req.method() != http::verb::delete_
         ) {
             return bad_request("Unknown HTTP-method");
         }
@@ -144,25 +199,24 @@ public:
             return bad_request("Illegal request-target");
         }
 
-
-        // TODO: handle POST/HEAD request for controllers
-
         auto const url = boost::urls::parse_origin_form(req.target());
-        auto const url_path = url->path();
-        if (url_path.contains("..")) {
+        std::string_view const path = decoded_path(*url);
+        if (path.contains("..")) {
             return not_found(req.target());
         }
 
-        if (req.method() == http::verb::get) {
-            // TODO: transparent hash
+        if (auto const match = routes_.match(path)) {
+            // app response; the controller checks method() itself
+            return (*match.value)->on_request(req, *url, match.params);
+        }
 
-            if (auto it = controllers_.find(url_path.c_str()); it != controllers_.end()) {
-                // app response
-                auto const& controller = it->second;
-                return controller->on_request(req, *url);
-            }
+        if (req.method() != http::verb::get && req.method() != http::verb::head) {
+            return method_not_allowed();
         }
 
+        // nothing calls decoded_path() again before this returns
+        std::string_view const url_path = path;
+
         // --------------------------------------------------
         // --------------------------------------------------
         // --------------------------------------------------
@@ -185,25 +239,56 @@ public:
             rel_path.remove_prefix(1);
         }
 
-        std::filesystem::path const path = [this, &rel_path, &url_path] {
-            auto path = public_root_ / std::string{rel_path};
-            if (url_path.back() == '/') {
-                path /= "index.html";
-            }
-            return path;
-        }();
+        std::string index_key{rel_path};
+        if (url_path.back() == '/') {
+            index_key += "index.html";
+        }
 
-        if (!is_safe_path(public_root_, path)) {
+        // only files under public_root can be found in the index, so this
+        // is also the traversal check
+        auto const index_entry = public_index_ ? public_index_->resolve(index_key) : nullptr;
+        if (!index_entry) {
             return not_found(req.target());
         }
 
-        auto const mime = mime_type(path);
+        auto const& path = index_entry->path;
+        auto const& mime = index_entry->mime;
+        auto const& info = index_entry->info;
+        auto const last_modified = format_http_date(info.last_modified());
+
+        auto const set_common_headers = [&](auto& res, ContentEncoding encoding, std::string const& etag) {
+            //res.set(http::field::server, "vein");
+            res.set(http::field::content_type, mime.type);
+            if (encoding != ContentEncoding::identity) {
+                res.set(http::field::content_encoding, to_string(encoding));
+            }
+            if (!mime.is_already_compressed) {
+                res.set(http::field::vary, "Accept-Encoding");
+            }
+            res.set(http::field::etag, etag);
+            res.set(http::field::last_modified, last_modified);
+            res.keep_alive(req.keep_alive());
+        };
+
+        // Revalidation: nothing is read nor compressed
+        auto const not_modified = [&](ContentEncoding encoding, std::string const& etag) -> Response {
+            http::response<http::empty_body> res{http::status::not_modified, req.version()};
+            set_common_headers(res, encoding, etag);
+            res.erase(http::field::content_type);
+            res.erase(http::field::content_encoding);
+            return res;
+        };
+
+        // Streams a file as-is; `encoding` is the coding the file is stored in
+        auto const send_file = [&](std::filesystem::path const& file_path, ContentEncoding encoding, std::string const& etag) -> Response {
+            if (is_not_modified(req, etag, info.last_modified())) {
+                return not_modified(encoding, etag);
+            }
 
-        if (mime.is_already_compressed) {
             // Attempt to open the file
             beast::error_code ec;
-            http::file_body::value_type body;
-            body.open(path.string().c_str(), beast::file_mode::scan, ec);
+            FileBody::value_type body;
+            body.open(file_path.string().c_str(), ec);
 
             // Handle the case where the file doesn't exist
             if (ec == beast::errc::no_such_file_or_directory) {
@@ -216,63 +301,184 @@ public:
             }
 
             // Cache the size since we need it after the move
-            auto const size = body.size();
+            auto const size = body.file_size();
 
             if (req.method() == http::verb::head) {
                 http::response<http::empty_body> res{http::status::ok, req.version()};
-                //res.set(http::field::server, "vein");
-                res.set(http::field::content_type, mime.type);
+                set_common_headers(res, encoding, etag);
+                res.set(http::field::accept_ranges, "bytes");
                 res.content_length(size);
+                return res;
+            }
+
+            std::optional<std::vector<ByteRange>> ranges;
+            if (auto const it = req.find(http::field::range); it != req.end() && if_range_matches(req, etag, info.last_modified())) {
+                ranges = parse_byte_ranges({it->value().data(), it->value().size()}, size);
+            }
+
+            if (ranges && ranges->empty()) {
+                http::response<http::empty_body> res{http::status::range_not_satisfiable, req.version()};
+                //res.set(http::field::server, "vein");
+                res.set(http::field::content_range, std::format("bytes */{}", size));
                 res.keep_alive(req.keep_alive());
+                res.content_length(0);
                 return res;
             }
 
-            http::response<http::file_body> res{
+            FileResponse res{
                 std::piecewise_construct,
                 std::make_tuple(std::move(body)),
                 std::make_tuple(http::status::ok, req.version())
             };
-            //res.set(http::field::server, "vein");
-            res.set(http::field::content_type, mime.type);
-            res.content_length(size);
-            res.keep_alive(req.keep_alive());
+            set_common_headers(res, encoding, etag);
+            res.set(http::field::accept_ranges, "bytes");
+
+            if (ranges) {
+                res.result(http::status::partial_content);
+
+                if (ranges->size() == 1) {
+                    auto const& range = ranges->front();
+                    res.body().set_region(range.first, range.size());
+                    res.set(http::field::content_range, content_range(range, size));
+                } else {
+                    // only the file regions are read; the part headers live in the body
+                    res.set(http::field::content_type, set_byteranges(res.body(), *ranges, mime.type));
+                }
+            }
+            res.content_length(res.body().size());
             return res;
+        };
 
-        } else {
-            http::response<http::vector_body<char, yk::default_init_allocator<char>>> res{http::status::ok, req.version()};
-            //res.set(http::field::server, "vein");
-            res.set(http::field::content_type, mime.type);
-            res.keep_alive(req.keep_alive());
+        auto const& compression = static_compression_options(index_key);
+
+        if (mime.is_already_compressed || info.size < compression.min_size) {
+            return send_file(path, ContentEncoding::identity, make_etag(info, ContentEncoding::identity));
+        }
+
+        auto const accept = accept_encoding(req);
+
+        // Precompressed sidecars ("foo.js.br" etc.) cost no CPU at all,
+        // so they are offered in addition to what the encoders can produce
+        EncodingSet sidecars;
+        std::array<PublicIndex::EntryPtr, content_encoding_count_v> sidecar_entries;
 
-            try {
-                std::ifstream file{path.string(), std::ios::in | std::ios::binary};
-                file.exceptions(std::ios::failbit | std::ios::badbit);
+        for (auto const sidecar_encoding : sidecar_encodings_v) {
+            if (accept.quality(sidecar_encoding) == 0) continue;
 
-                boost::iostreams::filtering_istream is;
+            auto& sidecar_entry = sidecar_entries[std::to_underlying(sidecar_encoding)];
+            sidecar_entry = fresh_sidecar(info, public_index_->find(index_key + std::string{sidecar_extension(sidecar_encoding)}));
+            if (sidecar_entry) {
+                sidecars.insert(sidecar_encoding);
+            }
+        }
+
+        auto const encoding = negotiate_encoding(accept, encoders_.available() | sidecars);
+
+        if (sidecars.contains(encoding)) {
+            // the sidecar is a different file from the one we would compress
+            // on the fly, hence its own tag
+            auto const& sidecar_entry = *sidecar_entries[std::to_underlying(encoding)];
+            return send_file(sidecar_entry.path, encoding, make_etag(sidecar_entry.info, encoding));
+        }
 
-                is.push(boost::iostreams::zlib_compressor());
-                is.push(file);
-                // TODO: reserve?
-                boost::iostreams::copy(is, std::back_inserter(res.body()));
+        auto const etag = make_etag(info, encoding);
 
-                res.set(http::field::content_encoding, "deflate");
+        if (encoding == ContentEncoding::identity) {
+            return send_file(path, ContentEncoding::identity, etag);
+        }
+
+        if (is_not_modified(req, etag, info.last_modified())) {
+            return not_modified(encoding, etag);
+        }
 
-            } catch (std::ios::failure const& /*e*/) {
-                //std::cerr << e.what(); << std::endl;
+        auto entry = static_cache_.find(path, encoding);
+        if (!entry) {
+            auto const generation = static_cache_.generation();
+            auto new_entry = std::make_shared<StaticCache::Entry>();
+            new_entry->mime = mime;
+            new_entry->encoding = encoding;
+
+            std::ifstream file{path.string(), std::ios::in | std::ios::binary};
+            if (!file) {
                 return not_found(req.target());
             }
 
-            res.prepare_payload();
+            auto const compressor = encoders_.acquire(encoding, compression);
+
+            new_entry->original_size = info.size;
+            new_entry->body.reserve(new_entry->original_size / 4);
+
+            std::array<char, 16 * 1024> buf;
+            while (file.read(buf.data(), buf.size()) || file.gcount() > 0) {
+                compressor->write({buf.data(), static_cast<std::size_t>(file.gcount())}, new_entry->body);
+            }
+            if (file.bad()) {
+                return server_error("failed to read file");
+            }
+            compressor->finish(new_entry->body);
+
+            entry = std::move(new_entry);
+            static_cache_.insert(path, entry, generation);
+        }
+
+        if (req.method() == http::verb::head) {
+            http::response<http::empty_body> res{http::status::ok, req.version()};
+            set_common_headers(res, encoding, etag);
+            res.content_length(entry->body.size());
             return res;
         }
+
+        SharedBody::value_type body{entry, net::buffer(entry->body.data(), entry->body.size())};
+
+        http::response<SharedBody> res{
+            std::piecewise_construct,
+            std::make_tuple(std::move(body)),
+            std::make_tuple(http::status::ok, req.version())
+        };
+        set_common_headers(res, encoding, etag);
+        res.prepare_payload();
+        return res;
     }
 
 
 private:
+    // The decoded path of `url`, in a buffer of the calling thread which the
+    // next call overwrites, so that routing a request does not allocate
+    [[nodiscard]] static std::string_view decoded_path(boost::urls::url_view const& url);
+
+    [[nodiscard]] static std::filesystem::path sidecar_path(std::filesystem::path const& path, ContentEncoding encoding)
+    {
+        auto res = path;
+        res += sidecar_extension(encoding);
+        return res;
+    }
+
+    // A sidecar older than its source is ignored rather than served
+    [[nodiscard]] static std::optional<FileInfo> fresh_sidecar_info(FileInfo const& info, std::filesystem::path const& sidecar);
+
+    [[nodiscard]] static PublicIndex::EntryPtr fresh_sidecar(FileInfo const& info, PublicIndex::EntryPtr sidecar) noexcept
+    {
+        if (!sidecar || sidecar->info.mtime_ns < info.mtime_ns) return nullptr;
+        return sidecar;
+    }
+
     std::filesystem::path public_root_ = ".";
     boost::urls::url canonical_url_origin_;
 
-    std::unordered_map<PathMatcher, std::unique_ptr<Controller>> controllers_;
+    std::vector<std::unique_ptr<Controller>> controllers_;
+    RouteTable<Controller*> routes_;
+
+    // sorted by descending prefix length; the last one is always ""
+    std::vector<std::pair<std::string, CompressionOptions>> static_compression_{
+        {std::string{}, CompressionOptions{.level = best_compression_level}}
+    };
+
+    EncoderRegistry encoders_;
+    StaticCache static_cache_;
+    PageCache page_cache_;
+    std::optional<net::any_io_executor> background_executor_;
+    std::unique_ptr<PublicIndex> public_index_;
+    std::unique_ptr<FileWatcher> public_root_watcher_;
 };
 
 }
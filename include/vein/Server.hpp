@@ -11,14 +11,28 @@ namespace vein {
 
 class Router;
 
+enum class ThreadingModel
+{
+    // One io_context run by all threads; every connection gets a strand
+    shared,
+
+    // One io_context per thread, each pinned to a core and accepting on
+    // its own SO_REUSEPORT socket, so connections never change threads.
+    // Stale cached pages are refreshed on one extra thread.
+    // Falls back to `shared` where SO_REUSEPORT is unavailable.
+    shard_per_core,
+};
+
 class Server
 {
 public:
+    // Serves until SIGINT or SIGTERM. `thread_count` must be at least 1.
     [[nodiscard]] int wait(
         std::string const& host,
         unsigned port,
         std::unique_ptr<Router> router, 
-        unsigned thread_count
+        unsigned thread_count,
+        ThreadingModel model = ThreadingModel::shared
     );
 
 private:
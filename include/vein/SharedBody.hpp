@@ -0,0 +1,67 @@
+﻿#ifndef VEIN_SHARED_BODY_HPP
+#define VEIN_SHARED_BODY_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/optional.hpp>
+
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+
+namespace vein {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = beast::net;
+
+// A response body which refers to immutable bytes owned by someone else
+// (e.g. a cache entry). Sending the body never copies the bytes, and the
+// owner is kept alive until the message is destroyed.
+struct SharedBody
+{
+    struct value_type
+    {
+        std::shared_ptr<void const> owner;
+        net::const_buffer buffer;
+    };
+
+    static std::uint64_t size(value_type const& body) noexcept
+    {
+        return body.buffer.size();
+    }
+
+    class writer
+    {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template<bool isRequest, class Fields>
+        writer(http::header<isRequest, Fields> const&, value_type const& body)
+            : body_(body)
+        {}
+
+        void init(beast::error_code& ec)
+        {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>>
+        get(beast::error_code& ec)
+        {
+            ec = {};
+            return {{body_.buffer, false}};
+        }
+
+    private:
+        value_type const& body_;
+    };
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+﻿#ifndef VEIN_STATIC_CACHE_HPP
+#define VEIN_STATIC_CACHE_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/ByteBuffer.hpp"
+#include "vein/Encoding.hpp"
+#include "vein/File.hpp"
+
+#include <array>
+#include <filesystem>
+#include <unordered_map>
+#include <shared_mutex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+
+namespace vein {
+
+// Bounded cache of compressed static assets, keyed by canonical path and
+// content-coding.
+//
+// Lookups only take a shared lock, so the cache can be used from all
+// I/O threads at once. When the byte budget is exceeded, entries which
+// have not been hit since the last sweep are evicted first (CLOCK).
+class StaticCache
+{
+public:
+    static constexpr std::size_t default_byte_budget = 64 * 1024 * 1024;
+
+    struct Entry
+    {
+        ByteBuffer body;
+        std::uint64_t original_size = 0;
+        MIME mime;
+        ContentEncoding encoding = ContentEncoding::identity;
+    };
+
+    using EntryPtr = std::shared_ptr<Entry const>;
+
+    explicit StaticCache(std::size_t byte_budget = default_byte_budget)
+        : byte_budget_(byte_budget)
+    {}
+
+    [[nodiscard]] EntryPtr find(std::filesystem::path const& canonical_path, ContentEncoding encoding) const;
+
+    // `generation` must be the value of `generation()` observed before the
+    // file was read; stale entries racing with an invalidation are dropped.
+    void insert(std::filesystem::path const& canonical_path, EntryPtr entry, std::uint64_t generation);
+
+    // Drop `path` and everything under it
+    void invalidate(std::filesystem::path const& path);
+
+    void clear();
+
+    [[nodiscard]] std::uint64_t generation() const noexcept { return generation_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] std::size_t byte_budget() const;
+    void set_byte_budget(std::size_t byte_budget);
+
+    [[nodiscard]] std::size_t bytes_used() const;
+
+private:
+    struct Slot
+    {
+        EntryPtr entry;
+        mutable std::atomic<bool> referenced{false};
+    };
+
+    // one slot per content-coding
+    using Slots = std::array<Slot, content_encoding_count_v>;
+
+    void evict_locked(std::size_t incoming);
+
+    mutable std::shared_mutex mtx_;
+    std::unordered_map<std::filesystem::path, Slots> entries_;
+    std::size_t byte_budget_ = default_byte_budget;
+    std::size_t bytes_used_ = 0;
+    std::atomic<std::uint64_t> generation_{0};
+};
+
+}
+
+#endif
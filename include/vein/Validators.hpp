@@ -0,0 +1,81 @@
+﻿#ifndef VEIN_VALIDATORS_HPP
+#define VEIN_VALIDATORS_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/Encoding.hpp"
+#include "vein/File.hpp"
+
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/field.hpp>
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+namespace vein {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Strong entity-tag derived from inode, size and mtime. Each content-coding
+// is a separate representation, so it is part of the tag.
+[[nodiscard]] std::string make_etag(FileInfo const& info, ContentEncoding encoding);
+
+// IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+[[nodiscard]] std::string format_http_date(std::chrono::sys_seconds time);
+
+// Only IMF-fixdate is accepted; the obsolete formats yield nullopt,
+// which makes the caller ignore the header field
+[[nodiscard]] std::optional<std::chrono::sys_seconds> parse_http_date(std::string_view str) noexcept;
+
+// Weak comparison against an `If-None-Match` field value (RFC 9110 13.1.2)
+[[nodiscard]] bool etag_list_matches(std::string_view etag_list, std::string_view etag) noexcept;
+
+// Evaluates `If-None-Match` / `If-Modified-Since` for a GET or HEAD request.
+// Returns true if 304 Not Modified should be sent.
+template<class Body, class Allocator>
+[[nodiscard]] bool is_not_modified(
+    http::request<Body, http::basic_fields<Allocator>> const& req,
+    std::string_view etag,
+    std::chrono::sys_seconds last_modified
+) noexcept
+{
+    if (auto const it = req.find(http::field::if_none_match); it != req.end()) {
+        // If-Modified-Since is ignored when If-None-Match is present
+        return etag_list_matches(std::string_view{it->value().data(), it->value().size()}, etag);
+    }
+
+    if (auto const it = req.find(http::field::if_modified_since); it != req.end()) {
+        auto const since = parse_http_date(std::string_view{it->value().data(), it->value().size()});
+        return since && last_modified <= *since;
+    }
+    return false;
+}
+
+// Evaluates `If-Range` (RFC 9110 13.1.5). Returns true if the `Range`
+// field should be honored, which is also the case when there is no `If-Range`.
+template<class Body, class Allocator>
+[[nodiscard]] bool if_range_matches(
+    http::request<Body, http::basic_fields<Allocator>> const& req,
+    std::string_view etag,
+    std::chrono::sys_seconds last_modified
+) noexcept
+{
+    auto const it = req.find(http::field::if_range);
+    if (it == req.end()) return true;
+
+    std::string_view const value{it->value().data(), it->value().size()};
+
+    // strong comparison; a weak tag never matches
+    if (value.starts_with('"')) return value == etag;
+    if (value.starts_with("W/")) return false;
+
+    auto const date = parse_http_date(value);
+    return date && *date == last_modified;
+}
+
+}
+
+#endif
@@ -0,0 +1,287 @@
+﻿#ifndef VEIN_HTML_ATTRIBUTES_HPP
+#define VEIN_HTML_ATTRIBUTES_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <sg14/inplace_vector.h>
+
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <cstdint>
+
+
+namespace vein::html {
+
+// Attribute names stored as an index instead of a string
+inline constexpr auto interned_attr_names_v = std::array<std::string_view, 20>{
+    "id",
+    "class",
+    "name",
+    "href",
+    "src",
+    "rel",
+    "content",
+    "type",
+    "value",
+    "action",
+    "method",
+    "lang",
+    "charset",
+    "alt",
+    "title",
+    "style",
+    "for",
+    "defer",
+    "async",
+    "placeholder",
+};
+
+class AttrKey
+{
+public:
+    AttrKey(std::string_view name)
+        : interned_(intern(name))
+    {
+        if (interned_ == not_interned) custom_ = name;
+    }
+
+    AttrKey(std::string&& name)
+        : interned_(intern(name))
+    {
+        if (interned_ == not_interned) custom_ = std::move(name);
+    }
+
+    AttrKey(std::string const& name) : AttrKey(std::string_view{name}) {}
+    AttrKey(char const* name) : AttrKey(std::string_view{name}) {}
+
+    [[nodiscard]] std::string_view view() const noexcept
+    {
+        return interned_ == not_interned ? std::string_view{custom_} : interned_attr_names_v[interned_];
+    }
+
+    operator std::string_view() const noexcept { return view(); }
+
+    friend bool operator==(AttrKey const& a, AttrKey const& b) noexcept
+    {
+        if (a.interned_ != not_interned || b.interned_ != not_interned) return a.interned_ == b.interned_;
+        return a.custom_ == b.custom_;
+    }
+
+    friend bool operator==(AttrKey const& a, std::string_view b) noexcept { return a.view() == b; }
+
+    static constexpr std::uint8_t not_interned = 0xff;
+
+    // Index of `name` in interned_attr_names_v, or not_interned
+    [[nodiscard]] static constexpr std::uint8_t intern(std::string_view name) noexcept
+    {
+        auto const it = std::ranges::find(interned_attr_names_v, name);
+        if (it == interned_attr_names_v.end()) return not_interned;
+        return static_cast<std::uint8_t>(it - interned_attr_names_v.begin());
+    }
+
+    // Compares with a name interned beforehand, e.g. once per lookup;
+    // only custom names are compared as strings
+    [[nodiscard]] bool matches(std::uint8_t interned, std::string_view name) const noexcept
+    {
+        if (interned != not_interned || interned_ != not_interned) return interned_ == interned;
+        return custom_ == name;
+    }
+
+private:
+    std::uint8_t interned_ = not_interned;
+    std::string custom_;
+};
+
+// Set of class names which keeps insertion order, so that the rendered
+// attribute is deterministic. A tag rarely has more than a few classes,
+// so a linear search beats hashing.
+class ClassList
+{
+public:
+    using value_type = std::string;
+    using const_iterator = std::vector<std::string>::const_iterator;
+
+    ClassList() = default;
+
+    ClassList(std::initializer_list<std::string> names)
+    {
+        for (auto const& name : names) insert(name);
+    }
+
+    [[nodiscard]] bool contains(std::string_view name) const noexcept
+    {
+        return std::ranges::find(names_, name) != names_.end();
+    }
+
+    std::pair<const_iterator, bool> insert(std::string name)
+    {
+        if (auto const it = std::ranges::find(names_, name); it != names_.end()) {
+            return {it, false};
+        }
+        names_.push_back(std::move(name));
+        return {std::prev(names_.cend()), true};
+    }
+
+    template<class... Args>
+    std::pair<const_iterator, bool> emplace(Args&&... args)
+    {
+        return insert(std::string(std::forward<Args>(args)...));
+    }
+
+    std::size_t erase(std::string_view name)
+    {
+        return std::erase(names_, name);
+    }
+
+    void clear() noexcept { names_.clear(); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return names_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return names_.empty(); }
+
+    [[nodiscard]] const_iterator begin() const noexcept { return names_.begin(); }
+    [[nodiscard]] const_iterator end() const noexcept { return names_.end(); }
+
+    bool operator==(ClassList const&) const = default;
+
+private:
+    std::vector<std::string> names_;
+};
+
+using AttrValue = std::variant<
+    std::monostate,
+    int,
+    std::string,
+    ClassList
+>;
+
+// Attributes of a tag in insertion order. The first inline_capacity
+// entries live inside the tag; more move everything to the heap.
+class AttrMap
+{
+public:
+    using value_type = std::pair<AttrKey, AttrValue>;
+    using iterator = value_type*;
+    using const_iterator = value_type const*;
+
+    static constexpr std::size_t inline_capacity = 4;
+
+    [[nodiscard]] iterator begin() noexcept { return data(); }
+    [[nodiscard]] iterator end() noexcept { return data() + size(); }
+    [[nodiscard]] const_iterator begin() const noexcept { return data(); }
+    [[nodiscard]] const_iterator end() const noexcept { return data() + size(); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return spill_.empty() ? inline_.size() : spill_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // The name is interned once, then compared by index
+    [[nodiscard]] iterator find(std::string_view name) noexcept
+    {
+        return std::ranges::find_if(*this, Matcher{name});
+    }
+    [[nodiscard]] const_iterator find(std::string_view name) const noexcept
+    {
+        return std::ranges::find_if(*this, Matcher{name});
+    }
+
+    [[nodiscard]] bool contains(std::string_view name) const noexcept { return find(name) != end(); }
+
+    [[nodiscard]] AttrValue& at(std::string_view name)
+    {
+        auto const it = find(name);
+        if (it == end()) throw std::out_of_range{"attribute not found: " + std::string{name}};
+        return it->second;
+    }
+    [[nodiscard]] AttrValue const& at(std::string_view name) const
+    {
+        auto const it = find(name);
+        if (it == end()) throw std::out_of_range{"attribute not found: " + std::string{name}};
+        return it->second;
+    }
+
+    AttrValue& operator[](std::string_view name)
+    {
+        return try_emplace(name).first->second;
+    }
+
+    // Like std::map, an existing attribute is left untouched
+    template<class K, class... Args>
+    std::pair<iterator, bool> try_emplace(K&& name, Args&&... args)
+    {
+        if (auto const it = find(std::string_view{name}); it != end()) {
+            return {it, false};
+        }
+        return {push_back(value_type{std::piecewise_construct, std::forward_as_tuple(std::forward<K>(name)), std::forward_as_tuple(std::forward<Args>(args)...)}), true};
+    }
+
+    template<class K, class V>
+    std::pair<iterator, bool> emplace(K&& name, V&& value)
+    {
+        return try_emplace(std::forward<K>(name), std::forward<V>(value));
+    }
+
+    std::size_t erase(std::string_view name)
+    {
+        if (spill_.empty()) {
+            auto const it = std::ranges::find_if(inline_, Matcher{name});
+            if (it == inline_.end()) return 0;
+            inline_.erase(it);
+            return 1;
+        }
+        return std::erase_if(spill_, Matcher{name});
+    }
+
+    void clear() noexcept
+    {
+        inline_.clear();
+        spill_.clear();
+    }
+
+private:
+    // Matches keys against a name which is interned once
+    struct Matcher
+    {
+        explicit Matcher(std::string_view name) noexcept
+            : name(name)
+            , interned(AttrKey::intern(name))
+        {}
+
+        bool operator()(value_type const& attr) const noexcept { return attr.first.matches(interned, name); }
+
+        std::string_view name;
+        std::uint8_t interned;
+    };
+
+    [[nodiscard]] value_type* data() noexcept { return spill_.empty() ? inline_.data() : spill_.data(); }
+    [[nodiscard]] value_type const* data() const noexcept { return spill_.empty() ? inline_.data() : spill_.data(); }
+
+    iterator push_back(value_type&& attr)
+    {
+        if (!spill_.empty()) {
+            return &spill_.emplace_back(std::move(attr));
+        }
+        if (inline_.size() < inline_capacity) {
+            return &inline_.emplace_back(std::move(attr));
+        }
+
+        spill_.reserve(inline_capacity * 2);
+        std::ranges::move(inline_, std::back_inserter(spill_));
+        inline_.clear();
+        return &spill_.emplace_back(std::move(attr));
+    }
+
+    sg14::inplace_vector<value_type, inline_capacity> inline_;
+    std::vector<value_type> spill_;
+};
+
+}
+
+#endif
@@ -7,6 +7,8 @@
 
 #include <charconv>
 #include <array>
+#include <memory>
+#include <string_view>
 
 
 namespace vein::html {
@@ -44,7 +46,7 @@ struct make_tag_content<PredefBuilder<type>>
     template<class T>
     static void apply(Tag& tag, T&& predef_builder)
     {
-        tag.contents().emplace_back(std::make_unique<Tag>(yk::forward_like<T>(predef_builder.tag_)));
+        tag.contents().emplace_back(std::forward<T>(predef_builder).make_tag());
     }
 };
 
@@ -75,11 +77,7 @@ public:
     template<class Self, class K, class V>
     decltype(auto) attr(this Self&& self, K&& k, V&& v)
     {
-        self.tag_.attrs().emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(std::forward<K>(k)),
-            std::forward_as_tuple(std::forward<V>(v))
-        );
+        self.tag_.attrs().emplace(std::forward<K>(k), std::forward<V>(v));
         return std::forward<Self>(self);
     }
 
@@ -101,6 +99,22 @@ public:
         return std::forward<Self>(self);
     }
 
+    // Serialize this subtree once and splice the bytes into every render.
+    // Subtrees cached under the same key share the bytes, and
+    // Fragment::invalidate(key) makes them render again.
+    template<class Self>
+    decltype(auto) cache(this Self&& self)
+    {
+        self.fragment_ = std::make_shared<Fragment>();
+        return std::forward<Self>(self);
+    }
+    template<class Self>
+    decltype(auto) cache(this Self&& self, std::string_view key)
+    {
+        self.fragment_ = Fragment::keyed(key);
+        return std::forward<Self>(self);
+    }
+
     template<class Self>
     decltype(auto) operator()(this Self&& self)
     {
@@ -116,11 +130,26 @@ public:
 
     operator std::unique_ptr<Tag>()
     {
-        return std::make_unique<Tag>(std::move(tag_));
+        return std::move(*this).make_tag();
+    }
+
+    operator TagPtr()
+    {
+        return std::move(*this).make_tag();
     }
 
 private:
+    // The fragment is attached last, since building the tag mutates it
+    template<class Self>
+    std::unique_ptr<Tag> make_tag(this Self&& self)
+    {
+        auto tag = std::make_unique<Tag>(yk::forward_like<Self>(self.tag_));
+        tag->set_fragment(yk::forward_like<Self>(self.fragment_));
+        return tag;
+    }
+
     Tag tag_{type};
+    std::shared_ptr<Fragment> fragment_;
 };
 
 namespace builders {
@@ -129,6 +158,9 @@ using html::Tag;
 using html::TagPtr;
 using html::TagType;
 using html::ClassList;
+using html::Text;
+using html::StaticMarkup;
+using html::Fragment;
 
 using h1      = PredefBuilder<TagType::h1>;
 using h2      = PredefBuilder<TagType::h2>;
@@ -6,8 +6,10 @@
 
 #include <yk/hash/string_hash.hpp>
 
+#include <memory>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 
 namespace vein::html {
@@ -26,6 +28,12 @@ struct Document
 
     Tag::callback_type default_callback_;
 
+    // Slot contents for the controller's RenderPlan, in document order
+    std::vector<Tag*> dynamic_tags;
+
+    // Index in dynamic_tags of the slot each dynamic tag is rendered in
+    std::unordered_map<Tag const*, std::size_t> slot_of;
+
     auto* tag_by_id(this auto&& self, std::string_view id)
     {
         auto const it = self.id_tag.find(id);
@@ -0,0 +1,27 @@
+﻿#ifndef VEIN_HTML_ESCAPE_HPP
+#define VEIN_HTML_ESCAPE_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/html/OutputBuffer.hpp"
+
+#include <string>
+#include <string_view>
+
+
+namespace vein::html {
+
+// Position of the first character in `str` which escape_html() replaces
+// (one of `&<>"'`), or str.size() if there is none.
+// Vectorized with AVX2 or SSE2 where available.
+[[nodiscard]] std::size_t find_html_special(std::string_view str) noexcept;
+
+// Appends `str` with `&<>"'` replaced by character references. Safe both
+// for text and for double- or single-quoted attribute values. Runs with
+// nothing to escape are copied in one go.
+void escape_html(OutputBuffer& out, std::string_view str);
+
+[[nodiscard]] std::string escape_html(std::string_view str);
+
+}
+
+#endif
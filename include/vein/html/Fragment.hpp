@@ -0,0 +1,63 @@
+﻿#ifndef VEIN_HTML_FRAGMENT_HPP
+#define VEIN_HTML_FRAGMENT_HPP
+
+#include "vein/LibraryConfig.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+
+namespace vein::html {
+
+// Serialized bytes of a subtree marked with PredefBuilder::cache(). Copies
+// of the tree, such as the ones in a request's Overlay, read the bytes
+// rendered from the original, so the subtree is walked once per version
+// instead of once per request. Text in the subtree is stored already escaped.
+class Fragment
+{
+public:
+    Fragment() = default;
+
+    explicit Fragment(std::string key)
+        : key_(std::move(key))
+    {}
+
+    Fragment(Fragment const&) = delete;
+    Fragment& operator=(Fragment const&) = delete;
+
+    // The fragment shared by every subtree cached under `key`; they must
+    // serialize to the same bytes
+    [[nodiscard]] static std::shared_ptr<Fragment> keyed(std::string_view key);
+
+    // Makes the subtrees cached under `key` render again, e.g. after the
+    // data they were built from has changed
+    static void invalidate(std::string_view key);
+
+    [[nodiscard]] std::string const& key() const noexcept { return key_; }
+
+    // null until rendered once since the last invalidate()
+    [[nodiscard]] std::shared_ptr<std::string const> bytes() const noexcept { return bytes_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] std::uint64_t version() const noexcept { return version_.load(std::memory_order_acquire); }
+
+    // `version` is the value of version() observed before rendering; bytes
+    // rendered before an invalidate() are dropped
+    void store(std::shared_ptr<std::string const> bytes, std::uint64_t version);
+
+    void invalidate();
+
+private:
+    std::string key_;
+
+    std::mutex mtx_; // serializes store() and invalidate()
+    std::atomic<std::shared_ptr<std::string const>> bytes_;
+    std::atomic<std::uint64_t> version_{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+﻿#ifndef VEIN_HTML_OUTPUT_BUFFER_HPP
+#define VEIN_HTML_OUTPUT_BUFFER_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/ByteBuffer.hpp"
+
+#include <charconv>
+#include <concepts>
+#include <string_view>
+#include <cstring>
+
+
+namespace vein::html {
+
+// Downstream consumer of an OutputBuffer, e.g. a compressor
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+
+    // Called with the serialized bytes in order
+    virtual void write(std::string_view bytes) = 0;
+};
+
+// Append-only sink for the HTML serializer.
+//
+// The storage is never zero-initialized and is kept across clear(), so a
+// buffer which is reused for every page stops allocating once it has
+// grown to the size of the largest page.
+//
+// With an OutputSink attached the buffer only stages bytes: they are
+// handed downstream whenever flush_threshold is reached, so the whole
+// page never exists in memory at once.
+class OutputBuffer
+{
+public:
+    // thread_local_buffer() starts over with a fresh buffer if a previous
+    // page left it larger than this
+    static constexpr std::size_t max_retained_capacity = 1024 * 1024;
+
+    static constexpr std::size_t default_flush_threshold = 16 * 1024;
+
+    OutputBuffer() = default;
+
+    explicit OutputBuffer(std::size_t capacity)
+    {
+        buf_.reserve(capacity);
+    }
+
+    void append(std::string_view str)
+    {
+        if (str.empty()) return;
+
+        if (sink_ && str.size() >= flush_threshold_) {
+            // large runs (e.g. plan segments) go downstream without a copy
+            flush();
+            sink_->write(str);
+            return;
+        }
+
+        auto const old_size = buf_.size();
+        buf_.resize(old_size + str.size());
+        std::memcpy(buf_.data() + old_size, str.data(), str.size());
+
+        if (sink_ && buf_.size() >= flush_threshold_) flush();
+    }
+
+    void push_back(char c)
+    {
+        buf_.push_back(c);
+        if (sink_ && buf_.size() >= flush_threshold_) flush();
+    }
+
+    template<std::integral T>
+    void append_integer(T value)
+    {
+        char buf[24];
+        auto const [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        append({buf, ptr});
+    }
+
+    OutputBuffer& operator+=(std::string_view str) { append(str); return *this; }
+    OutputBuffer& operator+=(char c) { push_back(c); return *this; }
+
+    void reserve(std::size_t capacity) { buf_.reserve(capacity); }
+    void clear() noexcept { buf_.clear(); }
+
+    void set_sink(OutputSink* sink, std::size_t flush_threshold = default_flush_threshold) noexcept
+    {
+        sink_ = sink;
+        flush_threshold_ = flush_threshold;
+    }
+
+    // Hand the buffered bytes to the sink, if any
+    void flush()
+    {
+        if (!sink_ || buf_.empty()) return;
+        sink_->write(view());
+        buf_.clear();
+    }
+
+    // The bytes not yet handed to the sink
+    [[nodiscard]] bool empty() const noexcept { return buf_.empty(); }
+    [[nodiscard]] std::size_t size() const noexcept { return buf_.size(); }
+    [[nodiscard]] std::size_t capacity() const noexcept { return buf_.capacity(); }
+    [[nodiscard]] char const* data() const noexcept { return buf_.data(); }
+
+    [[nodiscard]] std::string_view view() const noexcept { return {buf_.data(), buf_.size()}; }
+
+    // The underlying storage, e.g. to be swapped into a response body
+    [[nodiscard]] ByteBuffer& bytes() noexcept { return buf_; }
+
+    // An empty buffer without a sink, owned by the calling thread, for
+    // building one page at a time. The result must not be held across pages.
+    [[nodiscard]] static OutputBuffer& thread_local_buffer()
+    {
+        static thread_local OutputBuffer buffer;
+
+        if (buffer.capacity() > max_retained_capacity) {
+            buffer = OutputBuffer{};
+        }
+        buffer.clear();
+        buffer.set_sink(nullptr);
+        return buffer;
+    }
+
+private:
+    ByteBuffer buf_;
+    OutputSink* sink_ = nullptr;
+    std::size_t flush_threshold_ = default_flush_threshold;
+};
+
+}
+
+#endif
@@ -0,0 +1,131 @@
+﻿#ifndef VEIN_HTML_OVERLAY_HPP
+#define VEIN_HTML_OVERLAY_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/html/Tag.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+
+namespace vein::html {
+
+struct Document;
+
+// Backing store of an Overlay. Copies are carved out of one region whose
+// first block is kept between requests, and blocks freed by edits within
+// a request are pooled for reuse. release() drops everything at once.
+class Arena
+{
+public:
+    explicit Arena(std::size_t initial_size, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : buffer_size_(std::max<std::size_t>(initial_size, 1))
+        , buffer_(std::make_unique<std::byte[]>(buffer_size_))
+        , region_(buffer_.get(), buffer_size_, upstream)
+        , pool_(&region_)
+    {}
+
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+
+    [[nodiscard]] std::pmr::memory_resource* resource() noexcept { return &pool_; }
+
+    // Everything allocated must have been destroyed
+    void release() noexcept
+    {
+        pool_.release();
+        region_.release();
+    }
+
+private:
+    std::size_t buffer_size_;
+    std::unique_ptr<std::byte[]> buffer_;
+    std::pmr::monotonic_buffer_resource region_;
+    std::pmr::unsynchronized_pool_resource pool_;
+};
+
+// The changes one request makes to a controller's tree. The tree itself
+// is shared by all threads and never modified while serving: the first
+// write to a dynamic tag copies the slot around it into the overlay, and
+// rendering reads the copies in place of the shared tags. reset() throws
+// all copies away once the response is rendered.
+class Overlay
+{
+public:
+    // Resets the overlay when the request's scope ends
+    class Scope
+    {
+    public:
+        explicit Scope(Overlay& overlay) noexcept : overlay_(overlay) {}
+        ~Scope() { overlay_.reset(); }
+
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+
+    private:
+        Overlay& overlay_;
+    };
+
+    // `initial_size` bytes are kept for the copies between requests
+    explicit Overlay(std::size_t initial_size)
+        : arena_(initial_size)
+    {}
+
+    ~Overlay() { reset(); }
+
+    Overlay(Overlay const&) = delete;
+    Overlay& operator=(Overlay const&) = delete;
+
+    // This request's copy of `shared`, which is a dynamic tag (see
+    // is_dynamic_tag()) or <body> of the tree indexed by `doc`
+    [[nodiscard]] Tag* patch(Tag const& shared, Document const& doc);
+
+    // This request's copy of the whole tree, for changes anywhere in it.
+    // Tags patched before are carried over.
+    Tag* patch_root(Tag const& shared_root, Document const& doc);
+
+    // The copy of `shared` if this request has patched it
+    [[nodiscard]] Tag const& resolve(Tag const& shared) const noexcept
+    {
+        auto const* copy = find(shared, copies_.size());
+        return copy ? *copy : shared;
+    }
+
+    // Set once patch_root() has been called; render this instead of the plan
+    [[nodiscard]] Tag const* root() const noexcept { return root_; }
+
+    [[nodiscard]] bool empty() const noexcept { return owned_.empty(); }
+
+    void reset() noexcept
+    {
+        copies_.clear();
+        owned_.clear();
+        root_ = nullptr;
+        arena_.release();
+    }
+
+private:
+    // Searches the first `count` copies
+    [[nodiscard]] Tag* find(Tag const& shared, std::size_t count) const noexcept;
+
+    // Pairs the copy's addressable tags with their originals. Subtrees
+    // among the first `adopt_count` copies replace their fresh copies.
+    void record(Tag const& shared, Tag& copy, Document const& doc, std::size_t adopt_count);
+
+    Arena arena_;
+
+    // Roots of the copied subtrees
+    std::vector<TagPtr> owned_;
+
+    // A request patches a handful of tags; searched linearly
+    std::vector<std::pair<Tag const*, Tag*>> copies_;
+
+    Tag* root_ = nullptr;
+};
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+﻿#ifndef VEIN_HTML_RENDER_PLAN_HPP
+#define VEIN_HTML_RENDER_PLAN_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/html/Tag.hpp"
+#include "vein/html/OutputBuffer.hpp"
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace vein::html {
+
+struct Document;
+class Overlay;
+
+// Tags which may differ between requests: the ones reachable through
+// tag_by_id(), plus <title>, <meta name="description"> and
+// <link rel="canonical"> which Controller rewrites. Cached fragments are
+// slots too, so that invalidating them takes effect without a recompile.
+[[nodiscard]] bool is_dynamic_tag(Tag const& tag, Document const& doc) noexcept;
+
+// Fills doc.dynamic_tags with the outermost dynamic tags of `root` in
+// document order, and doc.slot_of with the slot of every dynamic tag.
+// Dynamic tags nested in another one are rendered as a part of their
+// ancestor.
+void index_dynamic_tags(Tag& root, Document& doc);
+
+// A page compiled into preserialized constant byte runs, with a slot at
+// each dynamic tag. Slots are preserialized too unless they contain a
+// cached fragment, so rendering only walks the subtrees a request patched.
+class RenderPlan
+{
+public:
+    RenderPlan() = default;
+
+    // `prefix` is emitted before the tree, e.g. the doctype
+    RenderPlan(std::string_view prefix, Tag const& root, Document const& doc);
+
+    [[nodiscard]] bool empty() const noexcept { return segments_.empty(); }
+    [[nodiscard]] std::size_t slot_count() const noexcept { return segments_.empty() ? 0 : segments_.size() - 1; }
+
+    // Total size of the constant segments and the default slot contents
+    [[nodiscard]] std::size_t static_size() const noexcept { return static_size_; }
+
+    // True if every slot is preserialized, in which case a render with
+    // nothing patched is exactly static_size() bytes long
+    [[nodiscard]] bool is_preserialized() const noexcept { return preserialized_; }
+
+    // `dynamic_tags` are the slots of the compiled tree, as indexed by
+    // index_dynamic_tags(); tags patched in `overlay` are rendered instead
+    void render(OutputBuffer& out, std::span<Tag* const> dynamic_tags, Overlay const& overlay) const;
+
+private:
+    void compile(Tag const& tag, Document const& doc, OutputBuffer& buf);
+
+    std::vector<std::string> segments_;
+
+    // Bytes of each slot as compiled; nullopt if it has to be rendered
+    std::vector<std::optional<std::string>> defaults_;
+    std::size_t static_size_ = 0;
+    bool preserialized_ = true;
+};
+
+}
+
+#endif
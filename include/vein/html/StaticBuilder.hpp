@@ -0,0 +1,291 @@
+﻿#ifndef VEIN_HTML_STATIC_BUILDER_HPP
+#define VEIN_HTML_STATIC_BUILDER_HPP
+
+#include "vein/LibraryConfig.hpp"
+#include "vein/html/Tag.hpp"
+
+#include <array>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+// Builders for markup made entirely of literals, serialized at compile time:
+//
+//   using namespace vein::html::static_builders;
+//   auto const menu = static_markup<[] {
+//       return nav.klass("menu")(
+//           a.attr("href", "/")(text("Home")),
+//           a.attr("href", "/about")(text("About"))
+//       );
+//   }>();
+//
+// The result is a StaticMarkup, which runtime builders accept as content
+// and which renders with a single copy. Unlike PredefBuilder, tags are
+// objects, not types, and children are passed with operator().
+namespace vein::html::static_builders {
+
+// Escaped like escape_html()
+struct StaticText
+{
+    std::string_view value;
+};
+
+[[nodiscard]] constexpr StaticText text(std::string_view value) noexcept
+{
+    return {value};
+}
+
+namespace detail {
+
+[[nodiscard]] constexpr std::string_view escape_sequence(char c) noexcept
+{
+    switch (c) {
+    case '&':  return "&amp;";
+    case '<':  return "&lt;";
+    case '>':  return "&gt;";
+    case '"':  return "&quot;";
+    case '\'': return "&#39;";
+    default:   return {};
+    }
+}
+
+[[nodiscard]] constexpr std::size_t escaped_size(std::string_view str) noexcept
+{
+    std::size_t size = 0;
+    for (char const c : str) {
+        auto const seq = escape_sequence(c);
+        size += seq.empty() ? 1 : seq.size();
+    }
+    return size;
+}
+
+constexpr void write(char*& out, std::string_view str) noexcept
+{
+    for (char const c : str) *out++ = c;
+}
+
+constexpr void write_escaped(char*& out, std::string_view str) noexcept
+{
+    for (char const c : str) {
+        if (auto const seq = escape_sequence(c); !seq.empty()) {
+            write(out, seq);
+        } else {
+            *out++ = c;
+        }
+    }
+}
+
+struct StaticAttr
+{
+    std::string_view name;
+    std::string_view value;
+    bool has_value = false;
+};
+
+template<class T>
+struct child
+{
+    // string literals are markup, as with PredefBuilder
+    using type = std::conditional_t<std::is_convertible_v<T, std::string_view>, std::string_view, T>;
+};
+
+template<class T>
+using child_t = typename child<std::remove_cvref_t<T>>::type;
+
+} // detail
+
+template<TagType type, std::size_t AttrCount, class... Children>
+class StaticBuilder
+{
+    template<TagType, std::size_t, class...>
+    friend class StaticBuilder;
+
+public:
+    constexpr StaticBuilder() noexcept = default;
+
+    [[nodiscard]] constexpr auto attr(std::string_view name) const
+    {
+        return with_attr({name, {}, false});
+    }
+
+    [[nodiscard]] constexpr auto attr(std::string_view name, std::string_view value) const
+    {
+        return with_attr({name, value, true});
+    }
+
+    [[nodiscard]] constexpr auto id(std::string_view value) const { return attr("id", value); }
+    [[nodiscard]] constexpr auto klass(std::string_view value) const { return attr("class", value); }
+
+    template<class... More>
+    [[nodiscard]] constexpr auto operator()(More&&... more) const
+    {
+        return StaticBuilder<type, AttrCount, Children..., detail::child_t<More>...>{
+            attrs_,
+            std::tuple_cat(children_, std::tuple<detail::child_t<More>...>{std::forward<More>(more)...})
+        };
+    }
+
+    // First pass: the number of bytes write() produces
+    [[nodiscard]] constexpr std::size_t size() const
+    {
+        if (is_void_element(type) && sizeof...(Children) > 0) {
+            throw "void element cannot contain content";
+        }
+
+        std::size_t size = 1 + tag_name(type).size() + 1; // <name>
+        for (auto const& attr : attrs_) {
+            size += 1 + attr.name.size();
+            if (attr.has_value) size += 2 + detail::escaped_size(attr.value) + 1;
+        }
+
+        std::apply([&](auto const&... children) {
+            ((size += child_size(children)), ...);
+        }, children_);
+
+        if (!is_void_element(type)) {
+            size += 2 + tag_name(type).size() + 1; // </name>
+        }
+        return size;
+    }
+
+    // Second pass: serialize into a buffer of size() bytes
+    constexpr void write(char*& out) const
+    {
+        *out++ = '<';
+        detail::write(out, tag_name(type));
+
+        for (auto const& attr : attrs_) {
+            *out++ = ' ';
+            detail::write(out, attr.name);
+            if (attr.has_value) {
+                detail::write(out, "=\"");
+                detail::write_escaped(out, attr.value);
+                *out++ = '"';
+            }
+        }
+        *out++ = '>';
+
+        std::apply([&](auto const&... children) {
+            (write_child(out, children), ...);
+        }, children_);
+
+        if (!is_void_element(type)) {
+            detail::write(out, "</");
+            detail::write(out, tag_name(type));
+            *out++ = '>';
+        }
+    }
+
+private:
+    constexpr StaticBuilder(std::array<detail::StaticAttr, AttrCount> attrs, std::tuple<Children...> children)
+        : attrs_(attrs)
+        , children_(std::move(children))
+    {}
+
+    [[nodiscard]] constexpr auto with_attr(detail::StaticAttr attr) const
+    {
+        std::array<detail::StaticAttr, AttrCount + 1> attrs{};
+        for (std::size_t i = 0; i < AttrCount; ++i) attrs[i] = attrs_[i];
+        attrs[AttrCount] = attr;
+        return StaticBuilder<type, AttrCount + 1, Children...>{attrs, children_};
+    }
+
+    [[nodiscard]] static constexpr std::size_t child_size(std::string_view markup) noexcept { return markup.size(); }
+    [[nodiscard]] static constexpr std::size_t child_size(StaticText const& text) noexcept { return detail::escaped_size(text.value); }
+
+    template<TagType child_type, std::size_t ChildAttrCount, class... GrandChildren>
+    [[nodiscard]] static constexpr std::size_t child_size(StaticBuilder<child_type, ChildAttrCount, GrandChildren...> const& child)
+    {
+        return child.size();
+    }
+
+    static constexpr void write_child(char*& out, std::string_view markup) noexcept { detail::write(out, markup); }
+    static constexpr void write_child(char*& out, StaticText const& text) noexcept { detail::write_escaped(out, text.value); }
+
+    template<TagType child_type, std::size_t ChildAttrCount, class... GrandChildren>
+    static constexpr void write_child(char*& out, StaticBuilder<child_type, ChildAttrCount, GrandChildren...> const& child)
+    {
+        child.write(out);
+    }
+
+    std::array<detail::StaticAttr, AttrCount> attrs_{};
+    std::tuple<Children...> children_{};
+};
+
+namespace detail {
+
+// One instance per builder lambda; the bytes live in static storage
+template<auto F>
+struct StaticStorage
+{
+    static constexpr std::size_t size = F().size();
+
+    static constexpr std::array<char, size> bytes = [] {
+        std::array<char, size> buf{};
+        char* out = buf.data();
+        F().write(out);
+        return buf;
+    }();
+};
+
+} // detail
+
+// `F` is a captureless lambda returning a static builder expression
+template<auto F>
+[[nodiscard]] consteval StaticMarkup static_markup() noexcept
+{
+    using Storage = detail::StaticStorage<F>;
+    return StaticMarkup{std::string_view{Storage::bytes.data(), Storage::size}};
+}
+
+template<TagType type>
+inline constexpr StaticBuilder<type, 0> static_tag{};
+
+inline constexpr auto h1      = static_tag<TagType::h1>;
+inline constexpr auto h2      = static_tag<TagType::h2>;
+inline constexpr auto h3      = static_tag<TagType::h3>;
+inline constexpr auto h4      = static_tag<TagType::h4>;
+inline constexpr auto h5      = static_tag<TagType::h5>;
+inline constexpr auto h6      = static_tag<TagType::h6>;
+
+inline constexpr auto section = static_tag<TagType::section>;
+inline constexpr auto aside   = static_tag<TagType::aside>;
+inline constexpr auto article = static_tag<TagType::article>;
+inline constexpr auto header  = static_tag<TagType::header>;
+inline constexpr auto footer  = static_tag<TagType::footer>;
+inline constexpr auto menu    = static_tag<TagType::menu>;
+inline constexpr auto nav     = static_tag<TagType::nav>;
+
+inline constexpr auto table   = static_tag<TagType::table>;
+inline constexpr auto thead   = static_tag<TagType::thead>;
+inline constexpr auto tbody   = static_tag<TagType::tbody>;
+inline constexpr auto tr      = static_tag<TagType::tr>;
+inline constexpr auto th      = static_tag<TagType::th>;
+inline constexpr auto td      = static_tag<TagType::td>;
+inline constexpr auto caption = static_tag<TagType::caption>;
+
+inline constexpr auto div    = static_tag<TagType::div>;
+inline constexpr auto p      = static_tag<TagType::p>;
+inline constexpr auto span   = static_tag<TagType::span>;
+inline constexpr auto a      = static_tag<TagType::a>;
+inline constexpr auto br     = static_tag<TagType::br>;
+
+inline constexpr auto ul     = static_tag<TagType::ul>;
+inline constexpr auto ol     = static_tag<TagType::ol>;
+inline constexpr auto li     = static_tag<TagType::li>;
+
+inline constexpr auto form   = static_tag<TagType::form>;
+inline constexpr auto input  = static_tag<TagType::input>;
+inline constexpr auto label  = static_tag<TagType::label>;
+inline constexpr auto button = static_tag<TagType::button>;
+inline constexpr auto main   = static_tag<TagType::main>;
+inline constexpr auto link   = static_tag<TagType::link>;
+inline constexpr auto style  = static_tag<TagType::style>;
+inline constexpr auto script = static_tag<TagType::script>;
+inline constexpr auto meta   = static_tag<TagType::meta>;
+
+} // vein::html::static_builders
+
+#endif
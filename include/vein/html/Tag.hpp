@@ -3,8 +3,10 @@
 
 #include "vein/LibraryConfig.hpp"
 #include "vein/HTTPField.hpp"
+#include "vein/html/Attributes.hpp"
+#include "vein/html/Fragment.hpp"
+#include "vein/html/OutputBuffer.hpp"
 
-#include <yk/hash/string_hash.hpp>
 #include <yk/util/overloaded.hpp>
 #include <yk/variant/std.hpp>
 
@@ -12,16 +14,18 @@
 #include <boost/beast/http/status.hpp>
 #include <boost/url/params_view.hpp>
 
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <ranges>
 #include <functional>
 #include <variant>
 #include <string>
+#include <string_view>
 #include <array>
 #include <type_traits>
+#include <utility>
 
 
 namespace vein {
@@ -160,6 +164,15 @@ constexpr bool is_void_element(TagType type) noexcept
     }
 }
 
+constexpr std::string_view tag_name(TagType type) noexcept
+{
+    auto const index = std::to_underlying(type);
+    if (index < 0 || index > std::to_underlying(TagType::_last_)) {
+        return "_invalid_";
+    }
+    return tag_type_names_v[index];
+}
+
 inline std::string to_string(TagType type)
 {
     auto const index = std::to_underlying(type);
@@ -169,19 +182,48 @@ inline std::string to_string(TagType type)
     return tag_type_names_v[index];
 }
 
-using ClassList = std::unordered_set<std::string, yk::string_hash, std::equal_to<>>;
+class Tag;
 
-using AttrValue = std::variant<
-    std::monostate,
-    int,
-    std::string,
-    ClassList
->;
+// Tags placed in a memory resource (the arena of a request's Overlay)
+// are destroyed and handed back to it; others are deleted
+struct TagDeleter
+{
+    std::pmr::memory_resource* resource = nullptr;
 
-class Tag;
-using TagPtr = std::unique_ptr<Tag>;
+    TagDeleter() = default;
 
-using TagContent = std::variant<TagPtr, std::string>;
+    explicit TagDeleter(std::pmr::memory_resource* resource) noexcept
+        : resource(resource)
+    {}
+
+    // std::make_unique<Tag>() results convert to TagPtr
+    TagDeleter(std::default_delete<Tag>) noexcept {}
+
+    void operator()(Tag* tag) const noexcept;
+};
+
+using TagPtr = std::unique_ptr<Tag, TagDeleter>;
+
+// A tag constructed in `resource`
+template<class... Args>
+[[nodiscard]] TagPtr allocate_tag(std::pmr::memory_resource* resource, Args&&... args);
+
+// Text content, escaped when rendered. Plain std::string contents are
+// emitted verbatim, for markup which is already HTML.
+struct Text
+{
+    std::string value;
+};
+
+// Markup with static storage duration, e.g. from static_builders::static_markup();
+// emitted verbatim with a single copy
+struct StaticMarkup
+{
+    std::string_view bytes;
+};
+
+using TagContent = std::variant<TagPtr, std::string, Text, StaticMarkup>;
+using TagContents = std::pmr::vector<TagContent>;
 
 
 class Tag
@@ -199,19 +241,31 @@ public:
     {}
 
     Tag(Tag const& other)
+        : Tag(other, std::pmr::get_default_resource())
+    {}
+
+    // Deep copy whose nodes and contents are allocated from `resource`;
+    // up to AttrMap::inline_capacity attributes are stored in the node.
+    // Strings longer than the SSO buffer, class lists and callbacks still
+    // use the heap. The copy reads the bytes of the original's fragment
+    // but never stores into it, since it may have been changed.
+    Tag(Tag const& other, std::pmr::memory_resource* resource)
         : type_(other.type_)
         , attrs_(other.attrs_)
+        , contents_(resource)
         , callback_(other.callback_)
+        , fragment_(other.fragment_)
+        , fragment_borrowed_(other.fragment_ != nullptr)
     {
         contents_.reserve(other.contents_.size());
 
         for (auto const& content : other.contents_) {
             contents_.emplace_back(std::visit<TagContent>(yk::overloaded{
-                [](TagPtr const& tag_ptr) {
-                    return std::make_unique<Tag>(*tag_ptr);
+                [&](TagPtr const& tag_ptr) {
+                    return allocate_tag(resource, *tag_ptr, resource);
                 },
                 [](auto const& value) {
-                    return value;
+                    return TagContent{value};
                 },
             }, content));
         }
@@ -220,11 +274,13 @@ public:
     [[nodiscard]] TagType type() const noexcept { return type_; }
     [[nodiscard]] bool is_void_element() const noexcept { return html::is_void_element(type_); }
 
+    // Mutable access detaches this tag from its cached fragment, since
+    // the bytes no longer match; use std::as_const() to only read
     [[nodiscard]] auto const& attrs() const noexcept { return attrs_; }
-    [[nodiscard]] auto& attrs() noexcept { return attrs_; }
+    [[nodiscard]] auto& attrs() noexcept { detach_fragment(); return attrs_; }
 
     [[nodiscard]] decltype(auto) classes() const noexcept { return std::get<ClassList>(attrs_.at("class")); }
-    [[nodiscard]] decltype(auto) classes() noexcept { return std::get<ClassList>(attrs_.at("class")); }
+    [[nodiscard]] decltype(auto) classes() noexcept { detach_fragment(); return std::get<ClassList>(attrs_.at("class")); }
 
     [[nodiscard]] bool matches(std::string_view attr, std::string_view value) const noexcept
     {
@@ -239,29 +295,56 @@ public:
 
     [[nodiscard]] std::string str() const;
 
+    // Appends the same as str(); prefer this for whole pages
+    void write_to(OutputBuffer& out) const;
+
+    // The pieces of write_to(), for callers which serialize the tree themselves
+    void write_start_tag(OutputBuffer& out) const;
+    void write_end_tag(OutputBuffer& out) const;
+
+    // <link rel="canonical"> and <meta name="description"> are not rendered
+    // until they have a value
+    [[nodiscard]] bool is_omitted() const noexcept;
+
+    // Set by PredefBuilder::cache(). Descendants of a cached tag are not
+    // meant to be modified; changes to them only show up once the
+    // fragment has been invalidated.
+    [[nodiscard]] Fragment* fragment() const noexcept { return fragment_.get(); }
+    void set_fragment(std::shared_ptr<Fragment> fragment) noexcept { fragment_ = std::move(fragment); fragment_borrowed_ = false; }
+    void detach_fragment() noexcept { fragment_.reset(); fragment_borrowed_ = false; }
+
     // ---------------------------------------
 
-    [[nodiscard]] std::vector<TagContent> const& contents() const noexcept { return contents_; }
-    [[nodiscard]] std::vector<TagContent>& contents() noexcept { return contents_; }
+    [[nodiscard]] TagContents const& contents() const noexcept { return contents_; }
+    [[nodiscard]] TagContents& contents() noexcept { detach_fragment(); return contents_; }
 
     template<class... Args>
     void append_string_content(Args&&... args)
     {
+        detach_fragment();
         contents_.emplace_back(std::string{std::forward<Args>(args)...});
     }
 
+    template<class... Args>
+    void append_text_content(Args&&... args)
+    {
+        detach_fragment();
+        contents_.emplace_back(Text{std::string{std::forward<Args>(args)...}});
+    }
+
     [[nodiscard]] auto children(this auto&& self, std::string_view attr_key, std::string_view attr_value) noexcept
     {
         return self.contents_
             | std::views::filter([attr_key = std::string{attr_key}, attr_value = std::string{attr_value}](auto const& tag_content) {
                 return yk::visit(
                     yk::overloaded{
-                        [](std::string const&) {
+                        [](auto const&) {
                             return false;
                         },
                         [&](TagPtr const& tag) {
-                            auto it = tag->attrs().find(attr_key);
-                            if (it == tag->attrs().end()) return false;
+                            auto const& attrs = std::as_const(*tag).attrs();
+                            auto it = attrs.find(attr_key);
+                            if (it == attrs.end()) return false;
 
                             if (auto* v = std::get_if<std::string>(&it->second)) {
                                 return *v == attr_value;
@@ -300,13 +383,40 @@ public:
     }
 
 private:
+    // write_to() without the fragment
+    void write_tree(OutputBuffer& out) const;
+
     TagType type_ = TagType::div;
-    std::unordered_map<std::string, AttrValue, yk::string_hash, std::equal_to<>> attrs_;
-    std::vector<TagContent> contents_;
+    AttrMap attrs_;
+    TagContents contents_;
 
     callback_type callback_;
+    std::shared_ptr<Fragment> fragment_;
+    bool fragment_borrowed_ = false; // a copy's; see the copy constructor
 };
 
+template<class... Args>
+TagPtr allocate_tag(std::pmr::memory_resource* resource, Args&&... args)
+{
+    void* p = resource->allocate(sizeof(Tag), alignof(Tag));
+    try {
+        return TagPtr{::new (p) Tag(std::forward<Args>(args)...), TagDeleter{resource}};
+    } catch (...) {
+        resource->deallocate(p, sizeof(Tag), alignof(Tag));
+        throw;
+    }
+}
+
+inline void TagDeleter::operator()(Tag* tag) const noexcept
+{
+    if (!resource) {
+        delete tag;
+        return;
+    }
+    tag->~Tag();
+    resource->deallocate(tag, sizeof(Tag), alignof(Tag));
+}
+
 }
 
 #endif
@@ -2,26 +2,121 @@
 #define VEIN_HTML_TEMPLATE_HPP
 
 #include "vein/LibraryConfig.hpp"
+#include "vein/html/OutputBuffer.hpp"
 
+#include <atomic>
+#include <cstddef>
 #include <filesystem>
-#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 
+namespace vein {
+
+class FileWatcher;
+
+} // vein
+
 namespace vein::html {
 
+// A template file parsed into constant segments with a slot between each
+// two of them. `{{name}}` is replaced by an escaped value and `{{&name}}`
+// by a raw one. Immutable once parsed, so it can be shared between threads.
+class Template
+{
+public:
+    // Throws std::invalid_argument on an unterminated or empty slot
+    [[nodiscard]] static Template parse(std::string_view source);
+
+    // The distinct slot names in order of first appearance
+    [[nodiscard]] std::span<std::string const> names() const noexcept { return names_; }
+
+    // Index into names() of `name`
+    [[nodiscard]] std::optional<std::size_t> find(std::string_view name) const noexcept;
+
+    // Total size of the constant segments
+    [[nodiscard]] std::size_t static_size() const noexcept { return static_size_; }
+
+    // `values` are indexed like names(); a slot whose name has no value
+    // renders empty
+    void render(OutputBuffer& out, std::span<std::string_view const> values) const;
+
+private:
+    struct Slot
+    {
+        std::size_t name;
+        bool raw = false;
+    };
+
+    std::vector<std::string> segments_; // slots_.size() + 1
+    std::vector<Slot> slots_;
+    std::vector<std::string> names_;
+    std::size_t static_size_ = 0;
+};
+
+// Loads templates under a root directory, parses them once and reloads
+// them when their files change. Lookups take a handle obtained up front
+// and never block: the templates are published as an immutable snapshot
+// which a reload replaces as a whole.
 class TemplateLoader
 {
 public:
-    explicit TemplateLoader(std::filesystem::path const& root)
-        : root_(root)
-    {}
+    // Refers to one template of the loader that returned it
+    class Handle
+    {
+    public:
+        Handle() = delete;
+
+    private:
+        friend TemplateLoader;
+
+        Handle(TemplateLoader const* loader, std::size_t index) noexcept
+            : loader_(loader)
+            , index_(index)
+        {}
+
+        TemplateLoader const* loader_;
+        std::size_t index_;
+    };
+
+    explicit TemplateLoader(std::filesystem::path const& root);
+    ~TemplateLoader();
+
+    TemplateLoader(TemplateLoader const&) = delete;
+    TemplateLoader& operator=(TemplateLoader const&) = delete;
 
-    std::string const& partial(std::string const& rel_path);
+    // Loads the partial `rel_path`, whose file name starts with an
+    // underscore; ".html" is appended. Resolve handles at startup, since
+    // this touches the filesystem on the first call for a path.
+    [[nodiscard]] Handle partial_handle(std::string const& rel_path);
+
+    // The current version of the template; `handle` must come from this loader
+    [[nodiscard]] std::shared_ptr<Template const> get(Handle handle) const;
 
 private:
+    struct Snapshot
+    {
+        std::vector<std::shared_ptr<Template const>> templates; // by handle
+    };
+
+    [[nodiscard]] static std::shared_ptr<Template const> load(std::filesystem::path const& path);
+
+    // Called with the paths reported by FileWatcher
+    void reload(std::filesystem::path const& changed);
+
     std::filesystem::path root_;
-    std::unordered_map<std::filesystem::path, std::string> partial_cache_;
+
+    std::mutex mtx_; // serializes partial_handle() and reload()
+    std::vector<std::filesystem::path> paths_; // by handle
+    std::atomic<std::shared_ptr<Snapshot const>> snapshot_;
+
+    // declared last, so that it stops before the rest is destroyed
+    std::unique_ptr<FileWatcher> watcher_;
 };
 
 }
@@ -7,21 +7,270 @@
 #include <yk/variant/boost.hpp>
 #include <yk/variant/std.hpp>
 
+#include <algorithm>
+#include <iostream>
+#include <memory_resource>
+#include <utility>
+
 
 namespace vein {
 
+namespace {
+
+// Starts the compressor on the first flushed byte, so pages that stay
+// below CompressionOptions::min_size never touch an encoder
+class CompressorSink final : public html::OutputSink
+{
+public:
+    CompressorSink(EncoderRegistry const& encoders, ContentEncoding encoding, CompressionOptions const& options, ByteBuffer& out) noexcept
+        : encoders_(encoders)
+        , encoding_(encoding)
+        , options_(options)
+        , out_(out)
+    {}
+
+    void write(std::string_view bytes) override
+    {
+        start();
+        compressor_->write(bytes, out_);
+    }
+
+    void finish()
+    {
+        start();
+        compressor_->finish(out_);
+    }
+
+    [[nodiscard]] bool started() const noexcept { return compressor_ != nullptr; }
+
+private:
+    void start()
+    {
+        if (!compressor_) compressor_ = encoders_.acquire(encoding_, options_);
+    }
+
+    EncoderRegistry const& encoders_;
+    ContentEncoding encoding_;
+    CompressionOptions const& options_;
+    ByteBuffer& out_;
+    PooledCompressor compressor_;
+};
+
+// Upstream of a trial arena, to learn how large the real ones should be
+class CountingResource final : public std::pmr::memory_resource
+{
+public:
+    [[nodiscard]] std::size_t allocated() const noexcept { return allocated_; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocated_ += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::size_t allocated_ = 0;
+};
+
+} // anon
+
 Controller::Controller() = default;
 Controller::~Controller() = default;
 
+EncoderRegistry const& Controller::encoders() const noexcept
+{
+    if (router_) {
+        return router_->encoders();
+    }
+    static EncoderRegistry const builtin_encoders;
+    return builtin_encoders;
+}
+
+PageCache* Controller::page_cache() const noexcept
+{
+    if (!router_ || !page_cache_options_) return nullptr;
+    return &router_->page_cache();
+}
+
+void Controller::set_page_cache_options(std::optional<PageCacheOptions> options)
+{
+    page_cache_options_ = std::move(options);
+
+    vary_ = "Accept-Encoding";
+    if (page_cache_options_) {
+        for (auto const& name : page_cache_options_->vary) {
+            vary_ += ", ";
+            vary_ += name;
+        }
+    }
+}
+
+std::optional<net::any_io_executor> Controller::background_executor() const
+{
+    if (!router_) return std::nullopt;
+    return router_->background_executor();
+}
+
+PageCache::EntryPtr Controller::make_page_cache_entry(PageResponse&& res) const
+{
+    if (res.result() != http::status::ok || res.find(http::field::set_cookie) != res.end()) {
+        return nullptr;
+    }
+
+    auto const now = PageCache::clock_type::now();
+
+    auto entry = std::make_shared<PageCache::Entry>();
+    entry->header = std::move(res.base());
+    entry->body.swap(res.body());
+    entry->expires = now + page_cache_options_->ttl;
+    entry->stale_expires = entry->expires + page_cache_options_->stale_while_revalidate;
+    return entry;
+}
+
+http::message_generator Controller::store_page(PageResponse&& res, std::string key, std::uint64_t generation, PageCache::Flight* flight, bool head) const
+{
+    auto const version = res.version();
+    auto const keep_alive = res.keep_alive();
+
+    auto entry = make_page_cache_entry(std::move(res));
+    if (entry) {
+        page_cache()->insert(std::move(key), entry, generation);
+    }
+    if (flight) {
+        flight->complete(entry);
+    }
+
+    if (!entry) return finish_response(std::move(res), head); // left untouched
+    return cached_response(std::move(entry), version, keep_alive, head);
+}
+
+http::message_generator Controller::cached_response(PageCache::EntryPtr entry, unsigned version, bool keep_alive, bool head)
+{
+    if (head) {
+        // the stored header has the Content-Length of the body
+        http::response<http::empty_body> res{entry->header};
+        res.version(version);
+        res.keep_alive(keep_alive);
+        return res;
+    }
+
+    SharedBody::value_type body{entry, net::buffer(entry->body.data(), entry->body.size())};
+
+    http::response<SharedBody> res{entry->header, std::move(body)};
+    res.version(version);
+    res.keep_alive(keep_alive);
+    return res;
+}
+
+http::message_generator Controller::finish_response(PageResponse&& res, bool head)
+{
+    if (!head) return std::move(res);
+
+    // prepare_payload() is not called again, so Content-Length stays
+    return http::response<http::empty_body>{std::move(res.base())};
+}
+
+std::optional<std::size_t> Controller::page_length(ContentEncoding encoding) const
+{
+    if (!plan_.is_preserialized() || !overlay().empty()) return std::nullopt;
+
+    // compressed lengths are only known after compressing
+    auto const size = plan_.static_size();
+    if (encoding != ContentEncoding::identity && size >= compression_options_.min_size) return std::nullopt;
+    return size;
+}
+
+std::size_t Controller::measure_overlay_size(html::Document const& doc)
+{
+    CountingResource counter;
+    {
+        html::Arena arena{1, &counter};
+        std::vector<html::Tag> copies;
+        copies.reserve(doc.dynamic_tags.size());
+        for (auto const* tag : doc.dynamic_tags) {
+            copies.emplace_back(*tag, arena.resource());
+        }
+    }
+    return counter.allocated();
+}
+
+Controller::RequestState*& Controller::current_request() noexcept
+{
+    static thread_local RequestState* state = nullptr;
+    return state;
+}
+
+RouteParams const& Controller::params() const noexcept
+{
+    static RouteParams const no_params;
+    auto const* state = current_request();
+    return state && state->params ? *state->params : no_params;
+}
+
+http::verb Controller::method() const noexcept
+{
+    auto const* state = current_request();
+    return state ? state->method : http::verb::unknown;
+}
+
+RequestBody::value_type const* Controller::request_body() const noexcept
+{
+    auto const* state = current_request();
+    return state ? state->body : nullptr;
+}
+
+Form const& Controller::form() const
+{
+    static Form const no_form;
+    auto* state = current_request();
+    if (!state || !state->body) return no_form;
+
+    if (!state->form) {
+        state->form = Form::parse(state->content_type, state->body->view());
+    }
+    return *state->form;
+}
+
+html::Overlay& Controller::overlay() const
+{
+    auto& overlay = local_overlay();
+    if (!overlay) {
+        overlay = std::make_unique<html::Overlay>(overlay_size_);
+    }
+    return *overlay;
+}
+
 void Controller::reset_html(std::unique_ptr<html::Tag>& html_, std::unique_ptr<html::Document>& doc_, std::unique_ptr<html::Tag> html)
 {
     html_ = std::move(html);
     doc_ = std::make_unique<html::Document>();
 
+    // the tags which Controller rewrites must not be baked into a fragment
+    int fragment_depth = 0;
+    auto const check_not_cached = [&](std::string_view what) {
+        if (fragment_depth > 0) {
+            throw std::logic_error{std::string{what} + "はキャッシュされたフラグメントの中に置けません"};
+        }
+    };
+
     yk::overloaded{
-        [&](this auto&& self, html::TagPtr& tag) -> void {
+        [&](this auto&& self, html::TagPtr const& tag) -> void {
             using html::TagType;
 
+            // only read, so that cached fragments stay attached
+            auto const& attrs = std::as_const(*tag).attrs();
+            bool const cached = tag->fragment() != nullptr;
+
             if (tag->type() == TagType::head) {
                 if (doc_->head_tag) {
                     throw std::logic_error{"<head>が複数あります"};
@@ -32,33 +281,40 @@ void Controller::reset_html(std::unique_ptr<html::Tag>& html_, std::unique_ptr<h
                 if (doc_->link_rel_canonical_tag) {
                     throw std::logic_error{"<link rel=\"canonical\">が複数あります"};
                 }
+                check_not_cached("<link rel=\"canonical\">");
                 doc_->link_rel_canonical_tag = tag.get();
             }
             if (tag->type() == TagType::meta && tag->matches("name", "description")) {
                 if (doc_->description_tag) {
                     throw std::logic_error("<meta name=\"description\">が複数あります");
                 }
+                check_not_cached("<meta name=\"description\">");
                 doc_->description_tag = tag.get();
             }
 
             if (tag->type() == TagType::title) {
+                check_not_cached("<title>");
                 doc_->title_tag = tag.get();
             }
 
             if (tag->type() == TagType::body) {
+                check_not_cached("<body>");
                 doc_->body_tag = tag.get();
             }
 
-            if (auto const it = tag->attrs().find("name"); it != tag->attrs().end()) {
+            if (auto const it = attrs.find("name"); it != attrs.end()) {
                 doc_->name_tag.emplace(std::get<std::string>(it->second), tag.get());
             }
-            if (auto const it = tag->attrs().find("id"); it != tag->attrs().end()) {
-                doc_->id_tag.emplace(std::get<std::string>(it->second), tag.get());
+            if (auto const it = attrs.find("id"); it != attrs.end()) {
+                // tag_by_id() patches it, which the fragment would not show
+                auto const& id = std::get<std::string>(it->second);
+                check_not_cached("id=\"" + id + "\"のタグ");
+                doc_->id_tag.emplace(id, tag.get());
             }
             if (tag->type() == TagType::form) {
                 std::string action;
 
-                if (auto const it = tag->attrs().find("action"); it == tag->attrs().end()) {
+                if (auto const it = attrs.find("action"); it == attrs.end()) {
                     action = "/";
 
                 } else {
@@ -68,15 +324,20 @@ void Controller::reset_html(std::unique_ptr<html::Tag>& html_, std::unique_ptr<h
 
                 doc_->form_action_tag.emplace(std::move(action), tag.get());
             }
-            self(tag->contents());
+
+            if (cached) ++fragment_depth;
+            self(std::as_const(*tag).contents());
+            if (cached) --fragment_depth;
         },
-        [](this auto&& self, std::vector<html::TagContent>& contents) -> void {
-            for (auto& content : contents) {
+        [](this auto&& self, html::TagContents const& contents) -> void {
+            for (auto const& content : contents) {
                 yk::visit<void>(self, content);
             }
         },
         [](std::string const&) {},
-    }(html_->contents());
+        [](html::Text const&) {},
+        [](html::StaticMarkup const&) {},
+    }(std::as_const(*html_).contents());
 
     if (!doc_->head_tag) {
         throw std::invalid_argument{"<head>がありません"};
@@ -86,6 +347,7 @@ void Controller::reset_html(std::unique_ptr<html::Tag>& html_, std::unique_ptr<h
         auto tag = std::make_unique<html::Tag>(html::TagType::meta);
         tag->attrs().emplace("name", "description");
         tag->attrs().emplace("content", "");
+        doc_->description_tag = tag.get();
         doc_->head_tag->contents().emplace_back(std::move(tag));
     }
 
@@ -93,34 +355,90 @@ void Controller::reset_html(std::unique_ptr<html::Tag>& html_, std::unique_ptr<h
         auto tag = std::make_unique<html::Tag>(html::TagType::link);
         tag->attrs().emplace("rel", "canonical");
         tag->attrs().emplace("href", "");
+        doc_->link_rel_canonical_tag = tag.get();
         doc_->head_tag->contents().emplace_back(std::move(tag));
     }
 }
 
-void Controller::set_title(std::string const& title)
+void Controller::render_html(html::OutputBuffer& out) const
+{
+    auto const& overlay = this->overlay();
+
+    if (auto const* root = overlay.root()) {
+        out += doctype;
+        root->write_to(out);
+        return;
+    }
+
+    plan_.render(out, doc_->dynamic_tags, overlay);
+}
+
+std::optional<ContentEncoding> Controller::render_page(ByteBuffer& body, ContentEncoding encoding) const
 {
-    reset_local_doc();
+    try {
+        if (encoding == ContentEncoding::identity) {
+            // serialized in place; the buffer becomes the response body as is
+            html::OutputBuffer page{plan_.static_size() + 4096};
+            render_html(page);
+            body.swap(page.bytes());
+            return ContentEncoding::identity;
+        }
+
+        CompressorSink sink{encoders(), encoding, compression_options_, body};
+
+        // nothing reaches the sink before min_size bytes are buffered
+        auto& page = html::OutputBuffer::thread_local_buffer();
+        page.set_sink(&sink, std::max(html::OutputBuffer::default_flush_threshold, compression_options_.min_size));
+
+        render_html(page);
+
+        if (!sink.started() && page.size() < compression_options_.min_size) {
+            auto const bytes = page.view();
+            body.assign(bytes.begin(), bytes.end());
+            page.set_sink(nullptr);
+            return ContentEncoding::identity;
+        }
+
+        body.reserve(plan_.static_size() / 4);
+        page.flush();
+        page.set_sink(nullptr);
+
+        sink.finish();
+        return encoding;
 
-    if (!local_doc()->title_tag) {
+    } catch (std::exception const& e) {
+        std::cerr << "uncaught exception while rendering controller: " << e.what() << std::endl;
+
+    } catch (...) {
+        std::cerr << "uncaught and uncatchable exception while rendering controller" << std::endl;
+    }
+
+    body.clear();
+    return std::nullopt;
+}
+
+void Controller::set_title(std::string const& title)
+{
+    if (!doc_->title_tag) {
         throw std::logic_error{"cannot set title because this html does not have title tag"};
     }
 
-    local_doc()->title_tag->contents().clear();
-    local_doc()->title_tag->append_string_content(title);
+    auto* const title_tag = overlay().patch(*doc_->title_tag, *doc_);
+    title_tag->contents().clear();
+    title_tag->append_string_content(title);
 }
 
 void Controller::set_description(std::string const& description)
 {
-    reset_local_doc();
-    local_doc()->description_tag->attrs()["content"] = description;
+    overlay().patch(*doc_->description_tag, *doc_)->attrs()["content"] = description;
 }
 
 void Controller::set_link_rel_canonical(std::optional<boost::urls::url> const& link_rel_canonical)
 {
-    reset_local_doc();
+    auto* const canonical_tag = overlay().patch(*doc_->link_rel_canonical_tag, *doc_);
 
     if (!link_rel_canonical) {
-        local_doc()->link_rel_canonical_tag->attrs()["href"] = std::string{};
+        canonical_tag->attrs()["href"] = std::string{};
         return;
     }
 
@@ -129,7 +447,7 @@ void Controller::set_link_rel_canonical(std::optional<boost::urls::url> const& l
     full_url.set_encoded_authority(router_->canonical_url_origin().encoded_authority());
     full_url.normalize();
 
-    local_doc()->link_rel_canonical_tag->attrs()["href"] = std::string{full_url.c_str()};
+    canonical_tag->attrs()["href"] = std::string{full_url.c_str()};
 }
 
 }
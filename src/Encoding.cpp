@@ -0,0 +1,480 @@
+﻿#include "pch.h"
+
+#include "vein/Encoding.hpp"
+
+#include <zlib.h>
+
+#if VEIN_ENABLE_BROTLI
+# include <brotli/encode.h>
+#endif
+
+#if VEIN_ENABLE_ZSTD
+# include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+
+namespace vein {
+
+namespace {
+
+constexpr char ascii_lower(char c) noexcept
+{
+    return ('A' <= c && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr bool iequals(std::string_view a, std::string_view b) noexcept
+{
+    return std::ranges::equal(a, b, [](char x, char y) { return ascii_lower(x) == ascii_lower(y); });
+}
+
+constexpr std::string_view trim_ows(std::string_view s) noexcept
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] )
+constexpr std::optional<int> parse_qvalue(std::string_view s) noexcept
+{
+    if (s.empty() || (s[0] != '0' && s[0] != '1')) return std::nullopt;
+
+    int q = (s[0] - '0') * 1000;
+    s.remove_prefix(1);
+
+    if (s.empty()) return q;
+    if (s[0] != '.') return std::nullopt;
+    s.remove_prefix(1);
+    if (s.size() > 3) return std::nullopt;
+
+    for (int scale = 100; char const c : s) {
+        if (c < '0' || '9' < c) return std::nullopt;
+        q += (c - '0') * scale;
+        scale /= 10;
+    }
+    return q > 1000 ? std::nullopt : std::optional<int>{q};
+}
+
+constexpr std::optional<ContentEncoding> parse_coding(std::string_view s) noexcept
+{
+    if (iequals(s, "identity")) return ContentEncoding::identity;
+    if (iequals(s, "deflate"))  return ContentEncoding::deflate;
+    if (iequals(s, "gzip"))     return ContentEncoding::gzip;
+    if (iequals(s, "x-gzip"))   return ContentEncoding::gzip;
+    if (iequals(s, "br"))       return ContentEncoding::br;
+    if (iequals(s, "zstd"))     return ContentEncoding::zstd;
+    return std::nullopt;
+}
+
+
+constexpr int zlib_strategy(CompressionStrategy strategy) noexcept
+{
+    switch (strategy) {
+    case CompressionStrategy::filtered:     return Z_FILTERED;
+    case CompressionStrategy::huffman_only: return Z_HUFFMAN_ONLY;
+    case CompressionStrategy::rle:          return Z_RLE;
+    case CompressionStrategy::fixed:        return Z_FIXED;
+    default:                                return Z_DEFAULT_STRATEGY;
+    }
+}
+
+class ZlibCompressor : public Compressor
+{
+public:
+    // window_bits: 15 for the zlib format ("deflate"), 15 + 16 for gzip
+    ZlibCompressor(CompressionOptions const& options, int window_bits)
+    {
+        int level = options.level;
+        if (level == default_compression_level) level = Z_DEFAULT_COMPRESSION;
+        level = std::min(level, Z_BEST_COMPRESSION);
+
+        if (deflateInit2(&zs_, level, Z_DEFLATED, window_bits, 8, zlib_strategy(options.strategy)) != Z_OK) {
+            throw std::runtime_error{"deflateInit2 failed"};
+        }
+    }
+
+    ~ZlibCompressor() override
+    {
+        deflateEnd(&zs_);
+    }
+
+    void write(std::string_view in, ByteBuffer& out) override
+    {
+        run(in, out, Z_NO_FLUSH);
+    }
+
+    void finish(ByteBuffer& out) override
+    {
+        run({}, out, Z_FINISH);
+    }
+
+    void reset() override
+    {
+        deflateReset(&zs_);
+    }
+
+private:
+    void run(std::string_view in, ByteBuffer& out, int flush)
+    {
+        zs_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+        zs_.avail_in = static_cast<uInt>(in.size());
+
+        do {
+            auto const old_size = out.size();
+            auto const chunk = std::max<std::size_t>(deflateBound(&zs_, zs_.avail_in), 256);
+            out.resize(old_size + chunk);
+
+            zs_.next_out = reinterpret_cast<Bytef*>(out.data() + old_size);
+            zs_.avail_out = static_cast<uInt>(chunk);
+
+            int const ret = deflate(&zs_, flush);
+            out.resize(out.size() - zs_.avail_out);
+
+            if (ret == Z_STREAM_END) break;
+            if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw std::runtime_error{"deflate failed"};
+            }
+        } while (zs_.avail_in > 0 || zs_.avail_out == 0 || flush == Z_FINISH);
+    }
+
+    z_stream zs_{};
+};
+
+#if VEIN_ENABLE_BROTLI
+
+class BrotliCompressor : public Compressor
+{
+public:
+    explicit BrotliCompressor(CompressionOptions const& options)
+        : level_(options.level == default_compression_level ? 5 : std::min(options.level, BROTLI_MAX_QUALITY))
+        , mode_(options.strategy == CompressionStrategy::default_strategy ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC)
+    {
+        reset();
+    }
+
+    ~BrotliCompressor() override
+    {
+        if (state_) BrotliEncoderDestroyInstance(state_);
+    }
+
+    void write(std::string_view in, ByteBuffer& out) override
+    {
+        run(in, out, BROTLI_OPERATION_PROCESS);
+    }
+
+    void finish(ByteBuffer& out) override
+    {
+        run({}, out, BROTLI_OPERATION_FINISH);
+    }
+
+    // The encoder has no reset; this is the only codec for which pooling
+    // does not save the context allocation
+    void reset() override
+    {
+        if (state_) BrotliEncoderDestroyInstance(state_);
+
+        state_ = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+        if (!state_) throw std::bad_alloc{};
+        BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, static_cast<std::uint32_t>(level_));
+        BrotliEncoderSetParameter(state_, BROTLI_PARAM_MODE, mode_);
+    }
+
+private:
+    void run(std::string_view in, ByteBuffer& out, BrotliEncoderOperation op)
+    {
+        auto avail_in = in.size();
+        auto const* next_in = reinterpret_cast<std::uint8_t const*>(in.data());
+
+        while (true) {
+            auto const old_size = out.size();
+            std::size_t const chunk = std::max<std::size_t>(avail_in, 4096);
+            out.resize(old_size + chunk);
+
+            auto avail_out = chunk;
+            auto* next_out = reinterpret_cast<std::uint8_t*>(out.data() + old_size);
+
+            if (!BrotliEncoderCompressStream(state_, op, &avail_in, &next_in, &avail_out, &next_out, nullptr)) {
+                throw std::runtime_error{"BrotliEncoderCompressStream failed"};
+            }
+            out.resize(out.size() - avail_out);
+
+            if (avail_in > 0 || BrotliEncoderHasMoreOutput(state_)) continue;
+            if (op == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(state_)) continue;
+            break;
+        }
+    }
+
+    int level_;
+    BrotliEncoderMode mode_;
+    BrotliEncoderState* state_ = nullptr;
+};
+
+#endif // VEIN_ENABLE_BROTLI
+
+#if VEIN_ENABLE_ZSTD
+
+class ZstdCompressor : public Compressor
+{
+public:
+    explicit ZstdCompressor(CompressionOptions const& options)
+        : cctx_(ZSTD_createCCtx())
+    {
+        if (!cctx_) throw std::bad_alloc{};
+
+        int level = options.level;
+        if (level == default_compression_level) level = 3;
+        level = std::min(level, 19); // levels above 19 need huge windows on the client side
+        ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level);
+
+        if (options.strategy == CompressionStrategy::huffman_only || options.strategy == CompressionStrategy::rle) {
+            ZSTD_CCtx_setParameter(cctx_, ZSTD_c_strategy, ZSTD_fast);
+        }
+    }
+
+    ~ZstdCompressor() override
+    {
+        ZSTD_freeCCtx(cctx_);
+    }
+
+    void write(std::string_view in, ByteBuffer& out) override
+    {
+        run(in, out, ZSTD_e_continue);
+    }
+
+    void finish(ByteBuffer& out) override
+    {
+        run({}, out, ZSTD_e_end);
+    }
+
+    void reset() override
+    {
+        ZSTD_CCtx_reset(cctx_, ZSTD_reset_session_only);
+    }
+
+private:
+    void run(std::string_view in, ByteBuffer& out, ZSTD_EndDirective directive)
+    {
+        ZSTD_inBuffer input{in.data(), in.size(), 0};
+
+        while (true) {
+            auto const old_size = out.size();
+            auto const chunk = std::max(ZSTD_compressBound(input.size - input.pos), ZSTD_CStreamOutSize());
+            out.resize(old_size + chunk);
+
+            ZSTD_outBuffer output{out.data() + old_size, chunk, 0};
+            auto const remaining = ZSTD_compressStream2(cctx_, &output, &input, directive);
+            out.resize(old_size + output.pos);
+
+            if (ZSTD_isError(remaining)) {
+                throw std::runtime_error{ZSTD_getErrorName(remaining)};
+            }
+
+            if (directive == ZSTD_e_end ? remaining == 0 : input.pos == input.size) break;
+        }
+    }
+
+    ZSTD_CCtx* cctx_;
+};
+
+#endif // VEIN_ENABLE_ZSTD
+
+
+// Idle compressors of the calling thread, most recently released last
+struct CompressorPool
+{
+    static constexpr std::size_t max_idle = 16;
+
+    struct Idle
+    {
+        PooledCompressorDeleter key;
+        std::unique_ptr<Compressor> compressor;
+    };
+
+    std::vector<Idle> idle;
+};
+
+CompressorPool& thread_compressor_pool() noexcept
+{
+    static thread_local CompressorPool pool;
+    return pool;
+}
+
+std::uint64_t next_registry_id() noexcept
+{
+    static std::atomic<std::uint64_t> id{0};
+    return ++id;
+}
+
+} // anon
+
+
+AcceptEncoding::AcceptEncoding(std::string_view field_value) noexcept
+    : present_(true)
+{
+    while (!field_value.empty()) {
+        auto const comma = field_value.find(',');
+        auto element = field_value.substr(0, comma);
+        field_value.remove_prefix(comma == std::string_view::npos ? field_value.size() : comma + 1);
+
+        auto const semi = element.find(';');
+        auto const coding = trim_ows(element.substr(0, semi));
+        if (coding.empty()) continue;
+
+        int q = max_quality;
+        if (semi != std::string_view::npos) {
+            auto params = element.substr(semi + 1);
+            while (!params.empty()) {
+                auto const next = params.find(';');
+                auto const param = trim_ows(params.substr(0, next));
+                params.remove_prefix(next == std::string_view::npos ? params.size() : next + 1);
+
+                if (param.size() >= 2 && ascii_lower(param[0]) == 'q' && param[1] == '=') {
+                    q = parse_qvalue(trim_ows(param.substr(2))).value_or(0);
+                }
+            }
+        }
+
+        if (coding == "*") {
+            star_ = q;
+        } else if (auto const encoding = parse_coding(coding)) {
+            quality_[std::to_underlying(*encoding)] = q;
+        }
+    }
+}
+
+int AcceptEncoding::quality(ContentEncoding encoding) const noexcept
+{
+    if (!present_) {
+        return encoding == ContentEncoding::identity ? max_quality : 0;
+    }
+
+    if (auto const q = quality_[std::to_underlying(encoding)]; q >= 0) {
+        return q;
+    }
+    if (star_ >= 0) {
+        return star_;
+    }
+
+    // identity is always acceptable unless explicitly excluded, but it
+    // should not win over a coding the client has asked for
+    return encoding == ContentEncoding::identity ? 1 : 0;
+}
+
+ContentEncoding negotiate_encoding(AcceptEncoding const& accept, EncodingSet available) noexcept
+{
+    auto best = ContentEncoding::identity;
+    int best_q = 0;
+
+    for (auto const encoding : encoding_preference_v) {
+        if (encoding != ContentEncoding::identity && !available.contains(encoding)) continue;
+
+        if (int const q = accept.quality(encoding); q > best_q) {
+            best = encoding;
+            best_q = q;
+        }
+    }
+
+    // Nothing is acceptable; identity is the least surprising answer
+    // (RFC 9110 permits it instead of 406)
+    return best;
+}
+
+
+Compressor::~Compressor() = default;
+
+void PooledCompressorDeleter::operator()(Compressor* compressor) const noexcept
+{
+    std::unique_ptr<Compressor> owned{compressor};
+
+    try {
+        owned->reset();
+
+        auto& idle = thread_compressor_pool().idle;
+        if (idle.size() >= CompressorPool::max_idle) {
+            idle.erase(idle.begin());
+        }
+        idle.push_back({*this, std::move(owned)});
+
+    } catch (...) {
+        // dropped; the next acquire() makes a new one
+    }
+}
+
+EncoderRegistry::EncoderRegistry()
+    : id_(next_registry_id())
+{
+    add(ContentEncoding::deflate, [](CompressionOptions const& options) {
+        return std::make_unique<ZlibCompressor>(options, 15);
+    });
+    add(ContentEncoding::gzip, [](CompressionOptions const& options) {
+        return std::make_unique<ZlibCompressor>(options, 15 + 16);
+    });
+
+#if VEIN_ENABLE_BROTLI
+    add(ContentEncoding::br, [](CompressionOptions const& options) {
+        return std::make_unique<BrotliCompressor>(options);
+    });
+#endif
+
+#if VEIN_ENABLE_ZSTD
+    add(ContentEncoding::zstd, [](CompressionOptions const& options) {
+        return std::make_unique<ZstdCompressor>(options);
+    });
+#endif
+}
+
+void EncoderRegistry::add(ContentEncoding encoding, factory_type factory)
+{
+    if (encoding == ContentEncoding::identity) {
+        throw std::invalid_argument{"identity does not have an encoder"};
+    }
+
+    factories_[std::to_underlying(encoding)] = std::move(factory);
+    available_.insert(encoding);
+
+    // pooled compressors made by the previous factory must not be reused
+    id_ = next_registry_id();
+}
+
+std::unique_ptr<Compressor> EncoderRegistry::make(ContentEncoding encoding, CompressionOptions const& options) const
+{
+    auto const& factory = factories_[std::to_underlying(encoding)];
+    if (!factory) {
+        throw std::invalid_argument{"encoder is not available: " + std::string{to_string(encoding)}};
+    }
+    return factory(options);
+}
+
+PooledCompressor EncoderRegistry::acquire(ContentEncoding encoding, CompressionOptions const& options) const
+{
+    PooledCompressorDeleter const key{id_, encoding, options.level, options.strategy};
+
+    auto& idle = thread_compressor_pool().idle;
+    for (auto it = idle.rbegin(); it != idle.rend(); ++it) {
+        if (it->key != key) continue;
+
+        auto compressor = std::move(it->compressor);
+        idle.erase(std::next(it).base());
+        return PooledCompressor{compressor.release(), key};
+    }
+    return PooledCompressor{make(encoding, options).release(), key};
+}
+
+void EncoderRegistry::compress(ContentEncoding encoding, std::string_view in, ByteBuffer& out, CompressionOptions const& options) const
+{
+    if (encoding == ContentEncoding::identity) {
+        out.insert(out.end(), in.begin(), in.end());
+        return;
+    }
+
+    auto const compressor = acquire(encoding, options);
+    compressor->write(in, out);
+    compressor->finish(out);
+}
+
+}
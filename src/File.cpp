@@ -0,0 +1,67 @@
+﻿#include "pch.h"
+
+#include "vein/File.hpp"
+
+#ifndef BOOST_MSVC
+# include <sys/stat.h>
+#endif
+
+
+namespace vein {
+
+#ifndef BOOST_MSVC
+
+namespace {
+
+std::optional<FileInfo> to_file_info(struct stat const& st) noexcept
+{
+    if (!S_ISREG(st.st_mode)) return std::nullopt;
+
+    FileInfo info;
+    info.size = static_cast<std::uint64_t>(st.st_size);
+    info.inode = static_cast<std::uint64_t>(st.st_ino);
+# ifdef __APPLE__
+    info.mtime_ns = std::int64_t{st.st_mtimespec.tv_sec} * 1'000'000'000 + st.st_mtimespec.tv_nsec;
+# else
+    info.mtime_ns = std::int64_t{st.st_mtim.tv_sec} * 1'000'000'000 + st.st_mtim.tv_nsec;
+# endif
+    return info;
+}
+
+} // anon
+
+std::optional<FileInfo> file_info(int fd)
+{
+    struct stat st;
+    if (::fstat(fd, &st) != 0) return std::nullopt;
+    return to_file_info(st);
+}
+
+#endif
+
+std::optional<FileInfo> file_info(std::filesystem::path const& path)
+{
+#ifndef BOOST_MSVC
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return std::nullopt;
+    return to_file_info(st);
+
+#else
+    std::error_code ec;
+    auto const status = std::filesystem::status(path, ec);
+    if (ec || !std::filesystem::is_regular_file(status)) return std::nullopt;
+
+    FileInfo info;
+    info.size = std::filesystem::file_size(path, ec);
+    if (ec) return std::nullopt;
+
+    auto const mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return std::nullopt;
+    info.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::clock_cast<std::chrono::system_clock>(mtime).time_since_epoch()
+    ).count();
+    return info;
+#endif
+}
+
+}
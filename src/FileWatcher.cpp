@@ -0,0 +1,141 @@
+﻿#include "pch.h"
+
+#include "vein/FileWatcher.hpp"
+
+#include <iostream>
+#include <cstdint>
+
+#ifdef __linux__
+# include <sys/inotify.h>
+# include <poll.h>
+# include <unistd.h>
+# include <cerrno>
+#endif
+
+
+namespace vein {
+
+#ifdef __linux__
+
+namespace {
+
+constexpr std::uint32_t watch_mask =
+    IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+    IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE |
+    IN_DELETE_SELF | IN_MOVE_SELF;
+
+} // anon
+
+FileWatcher::FileWatcher(std::filesystem::path const& root, callback_type callback)
+    : root_(root)
+    , callback_(std::move(callback))
+{
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        std::cerr << "warning: inotify_init1 failed; file changes under " << root_ << " will not be detected" << std::endl;
+        return;
+    }
+
+    add_watch_recursive(root_);
+
+    thread_ = std::jthread{[this](std::stop_token stop_token) {
+        run(std::move(stop_token));
+    }};
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (thread_.joinable()) {
+        thread_.request_stop();
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void FileWatcher::add_watch_recursive(std::filesystem::path const& dir)
+{
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec)) return;
+
+    if (int const wd = ::inotify_add_watch(fd_, dir.c_str(), watch_mask); wd >= 0) {
+        wd_path_.insert_or_assign(wd, dir);
+    }
+
+    for (auto it = std::filesystem::recursive_directory_iterator{dir, ec};
+        !ec && it != std::filesystem::recursive_directory_iterator{};
+        it.increment(ec)
+    ) {
+        if (!it->is_directory(ec)) continue;
+
+        if (int const wd = ::inotify_add_watch(fd_, it->path().c_str(), watch_mask); wd >= 0) {
+            wd_path_.insert_or_assign(wd, it->path());
+        }
+    }
+}
+
+void FileWatcher::run(std::stop_token stop_token)
+{
+    alignas(inotify_event) char buf[16 * 1024];
+
+    while (!stop_token.stop_requested()) {
+        pollfd pfd{fd_, POLLIN, 0};
+        if (int const n = ::poll(&pfd, 1, 250); n <= 0) {
+            continue;
+        }
+
+        auto const len = ::read(fd_, buf, sizeof(buf));
+        if (len <= 0) {
+            if (len < 0 && errno != EAGAIN && errno != EINTR) {
+                std::cerr << "warning: failed to read inotify events" << std::endl;
+                return;
+            }
+            continue;
+        }
+
+        for (char const* p = buf; p < buf + len;) {
+            auto const* ev = reinterpret_cast<inotify_event const*>(p);
+            p += sizeof(inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // we lost track of what has changed
+                callback_(root_);
+                continue;
+            }
+
+            auto const it = wd_path_.find(ev->wd);
+            if (it == wd_path_.end()) continue;
+
+            if (ev->mask & IN_IGNORED) {
+                wd_path_.erase(it);
+                continue;
+            }
+
+            auto const path = ev->len ? it->second / ev->name : it->second;
+
+            if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO))) {
+                add_watch_recursive(path);
+            }
+
+            callback_(path);
+        }
+    }
+}
+
+#else // __linux__
+
+FileWatcher::FileWatcher(std::filesystem::path const& root, callback_type callback)
+    : root_(root)
+    , callback_(std::move(callback))
+{}
+
+FileWatcher::~FileWatcher() = default;
+
+void FileWatcher::add_watch_recursive(std::filesystem::path const&) {}
+
+void FileWatcher::run(std::stop_token) {}
+
+#endif
+
+}
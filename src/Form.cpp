@@ -0,0 +1,252 @@
+﻿#include "pch.h"
+
+#include "vein/Form.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace vein {
+
+namespace {
+
+[[nodiscard]] int hex_value(char c) noexcept
+{
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('a' <= c && c <= 'f') return c - 'a' + 10;
+    if ('A' <= c && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes one character of `encoded` at `i`, advancing past it
+[[nodiscard]] char decode_char(std::string_view encoded, std::size_t& i) noexcept
+{
+    char const c = encoded[i++];
+    if (c == '+') return ' ';
+
+    if (c == '%' && i + 2 <= encoded.size()) {
+        int const hi = hex_value(encoded[i]);
+        int const lo = hex_value(encoded[i + 1]);
+        if (hi >= 0 && lo >= 0) {
+            i += 2;
+            return static_cast<char>(hi * 16 + lo);
+        }
+    }
+    return c;
+}
+
+// Compares without decoding into a buffer
+[[nodiscard]] bool decoded_equals(std::string_view encoded, std::string_view plain) noexcept
+{
+    std::size_t i = 0, j = 0;
+    while (i < encoded.size() && j < plain.size()) {
+        if (decode_char(encoded, i) != plain[j++]) return false;
+    }
+    return i == encoded.size() && j == plain.size();
+}
+
+[[nodiscard]] bool iequals(std::string_view a, std::string_view b) noexcept
+{
+    return std::ranges::equal(a, b, [](char x, char y) {
+        auto const lower = [](char c) { return 'A' <= c && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+        return lower(x) == lower(y);
+    });
+}
+
+[[nodiscard]] std::string_view trim(std::string_view str) noexcept
+{
+    auto const first = str.find_first_not_of(" \t");
+    if (first == std::string_view::npos) return {};
+    return str.substr(first, str.find_last_not_of(" \t") - first + 1);
+}
+
+// The `key` parameter of a header value such as
+// `form-data; name="a"; filename="b"`; quotes are removed
+[[nodiscard]] std::optional<std::string_view> header_param(std::string_view value, std::string_view key) noexcept
+{
+    while (!value.empty()) {
+        auto const semi = value.find(';');
+        if (semi == std::string_view::npos) break;
+        value.remove_prefix(semi + 1);
+
+        auto const eq = value.find('=');
+        if (eq == std::string_view::npos) break;
+
+        auto const name = trim(value.substr(0, eq));
+        value.remove_prefix(eq + 1);
+        value = trim(value);
+
+        std::string_view param;
+        if (value.starts_with('"')) {
+            auto const close = value.find('"', 1);
+            if (close == std::string_view::npos) return std::nullopt;
+            param = value.substr(1, close - 1);
+            value.remove_prefix(close + 1);
+        } else {
+            param = trim(value.substr(0, value.find(';')));
+            value.remove_prefix(param.size());
+        }
+
+        if (iequals(name, key)) return param;
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::string_view media_type(std::string_view content_type) noexcept
+{
+    return trim(content_type.substr(0, content_type.find(';')));
+}
+
+} // anon
+
+std::string decode_form_component(std::string_view encoded)
+{
+    std::string res;
+    res.reserve(encoded.size());
+    for (std::size_t i = 0; i < encoded.size();) {
+        res += decode_char(encoded, i);
+    }
+    return res;
+}
+
+std::string Form::Field::decoded_name() const
+{
+    return urlencoded ? decode_form_component(name) : std::string{name};
+}
+
+std::string Form::Field::decoded_value() const
+{
+    return urlencoded ? decode_form_component(value) : std::string{value};
+}
+
+Form Form::parse(std::string_view content_type, std::string_view body)
+{
+    auto const type = media_type(content_type);
+
+    if (iequals(type, "application/x-www-form-urlencoded")) {
+        return parse_urlencoded(body);
+    }
+    if (iequals(type, "multipart/form-data")) {
+        auto const boundary = header_param(content_type, "boundary");
+        if (!boundary || boundary->empty()) {
+            throw std::invalid_argument{"multipart/form-data without boundary"};
+        }
+        return parse_multipart(*boundary, body);
+    }
+    return {};
+}
+
+Form Form::parse_urlencoded(std::string_view body)
+{
+    Form form;
+    form.fields_.reserve(std::ranges::count(body, '&') + 1);
+
+    while (!body.empty()) {
+        auto const amp = body.find('&');
+        auto const pair = body.substr(0, amp);
+        body.remove_prefix(amp == std::string_view::npos ? body.size() : amp + 1);
+
+        if (pair.empty()) continue;
+
+        auto const eq = pair.find('=');
+        Field field;
+        field.name = pair.substr(0, eq);
+        field.value = eq == std::string_view::npos ? std::string_view{} : pair.substr(eq + 1);
+        field.urlencoded = true;
+        form.fields_.push_back(field);
+    }
+    return form;
+}
+
+// https://www.rfc-editor.org/rfc/rfc7578
+Form Form::parse_multipart(std::string_view boundary, std::string_view body)
+{
+    // every delimiter but the first one is preceded by CRLF
+    std::string const delimiter = "\r\n--" + std::string{boundary};
+    auto const first = std::string_view{delimiter}.substr(2);
+
+    auto pos = body.starts_with(first) ? 0 : body.find(delimiter);
+    if (pos == std::string_view::npos) {
+        throw std::invalid_argument{"multipart boundary not found"};
+    }
+    pos += pos == 0 ? first.size() : delimiter.size();
+
+    Form form;
+
+    while (true) {
+        auto rest = body.substr(pos);
+        if (rest.starts_with("--")) break; // close delimiter
+
+        // transport padding after the boundary, then CRLF
+        rest = rest.substr(std::min(rest.find_first_not_of(" \t"), rest.size()));
+        if (!rest.starts_with("\r\n")) {
+            throw std::invalid_argument{"malformed multipart boundary line"};
+        }
+        pos = body.size() - rest.size() + 2;
+
+        auto const headers_end = body.find("\r\n\r\n", pos - 2);
+        if (headers_end == std::string_view::npos) {
+            throw std::invalid_argument{"unterminated multipart headers"};
+        }
+        auto headers = body.substr(pos, headers_end - std::min(pos, headers_end));
+        auto const content = headers_end + 4;
+
+        auto const next = body.find(delimiter, content);
+        if (next == std::string_view::npos) {
+            throw std::invalid_argument{"unterminated multipart part"};
+        }
+
+        Field field;
+        field.value = body.substr(content, next - content);
+
+        bool has_name = false;
+        while (!headers.empty()) {
+            auto const eol = headers.find("\r\n");
+            auto const line = headers.substr(0, eol);
+            headers.remove_prefix(eol == std::string_view::npos ? headers.size() : eol + 2);
+
+            auto const colon = line.find(':');
+            if (colon == std::string_view::npos) continue;
+
+            auto const name = trim(line.substr(0, colon));
+            auto const value = trim(line.substr(colon + 1));
+
+            if (iequals(name, "Content-Disposition")) {
+                if (auto const param = header_param(value, "name")) {
+                    field.name = *param;
+                    has_name = true;
+                }
+                if (auto const param = header_param(value, "filename")) {
+                    field.filename = *param;
+                }
+            } else if (iequals(name, "Content-Type")) {
+                field.content_type = value;
+            }
+        }
+
+        if (!has_name) {
+            throw std::invalid_argument{"multipart part without a name"};
+        }
+        form.fields_.push_back(field);
+
+        pos = next + delimiter.size();
+    }
+    return form;
+}
+
+Form::Field const* Form::find(std::string_view name) const noexcept
+{
+    auto const it = std::ranges::find_if(fields_, [&](Field const& field) {
+        return field.urlencoded ? decoded_equals(field.name, name) : field.name == name;
+    });
+    return it == fields_.end() ? nullptr : &*it;
+}
+
+std::optional<std::string> Form::get(std::string_view name) const
+{
+    auto const* field = find(name);
+    if (!field) return std::nullopt;
+    return field->decoded_value();
+}
+
+}
@@ -4,24 +4,90 @@
 #include "vein/File.hpp"
 #include "vein/Router.hpp"
 
+#ifdef __linux__
+# include <boost/asio/write.hpp>
+
+# include <sys/sendfile.h>
+# include <cerrno>
+#endif
+
 
 namespace vein {
 
-void HTTPSession::on_read(beast::error_code ec, std::size_t bytes_transferred)
+namespace {
+
+// The connection is closed afterwards, since the rest of the body
+// would have to be drained
+http::response<http::string_body> payload_too_large(unsigned version)
 {
-    boost::ignore_unused(bytes_transferred);
+    http::response<http::string_body> res{http::status::payload_too_large, version};
+    //res.set(http::field::server, "vein");
+    res.set(http::field::content_type, "text/html");
+    res.keep_alive(false);
+    res.body() = "Request body too large";
+    res.prepare_payload();
+    return res;
+}
+
+} // anon
 
+bool HTTPSession::handle_read_error(beast::error_code ec)
+{
     // This means they closed the connection
     if (ec == http::error::end_of_stream) {
-        return do_close();
+        do_close();
+        return true;
     }
     if (ec == beast::error::timeout) {
-        return; // prevent printing "The socket was closed due to a timeout"
+        return true; // prevent printing "The socket was closed due to a timeout"
     }
     if (ec) {
-        return fail(ec, "read");
+        fail(ec, "read");
+        return true;
+    }
+    return false;
+}
+
+void HTTPSession::on_read_header(beast::error_code ec, std::size_t bytes_transferred)
+{
+    boost::ignore_unused(bytes_transferred);
+
+    if (handle_read_error(ec)) return;
+
+    auto const& header = header_parser_->get();
+    auto const options = router_->request_body_options(header);
+
+    // Refused before any of the body is read
+    if (auto const length = header_parser_->content_length(); length && *length > options.limit) {
+        return queue_write(payload_too_large(header.version()));
+    }
+
+    parser_.emplace(std::move(*header_parser_));
+    header_parser_.reset();
+
+    parser_->body_limit(options.limit);
+    parser_->get().body().set_memory_limit(options.memory_limit);
+
+    http::async_read(
+        stream_,
+        buffer_,
+        *parser_,
+        beast::bind_front_handler(
+            &HTTPSession::on_read,
+            shared_from_this()));
+}
+
+void HTTPSession::on_read(beast::error_code ec, std::size_t bytes_transferred)
+{
+    boost::ignore_unused(bytes_transferred);
+
+    // a chunked body which grew past the limit
+    if (ec == http::error::body_limit) {
+        return queue_write(payload_too_large(parser_->get().version()));
     }
 
+    if (handle_read_error(ec)) return;
+
 #if VEIN_ENABLE_WEBSOCKET
     // See if it is a WebSocket Upgrade
     if (websocket::is_upgrade(parser_->get())) {
@@ -42,4 +108,171 @@ void HTTPSession::on_read(beast::error_code ec, std::size_t bytes_transferred)
     }
 }
 
+void HTTPSession::do_write_file(FileResponse& res, bool keep_alive)
+{
+#ifdef __linux__
+    file_serializer_.emplace(res);
+
+    http::async_write_header(
+        stream_,
+        *file_serializer_,
+        beast::bind_front_handler(
+            &HTTPSession::on_write_file_header,
+            shared_from_this(),
+            keep_alive));
+
+#else
+    http::async_write(
+        stream_,
+        res,
+        beast::bind_front_handler(
+            &HTTPSession::on_write,
+            shared_from_this(),
+            keep_alive));
+#endif
+}
+
+#ifdef __linux__
+
+void HTTPSession::on_write_file_header(bool keep_alive, beast::error_code ec, std::size_t bytes_transferred)
+{
+    boost::ignore_unused(bytes_transferred);
+
+    if (ec) {
+        file_serializer_.reset();
+        return fail(ec, "write");
+    }
+
+    stream_.socket().native_non_blocking(true, ec);
+    if (ec) {
+        file_serializer_.reset();
+        return fail(ec, "write");
+    }
+
+    sendfile_segment_ = 0;
+    do_write_segment(keep_alive);
+}
+
+void HTTPSession::do_write_segment(bool keep_alive)
+{
+    auto const& body = response_queue_.front().file()->body();
+    auto const& segments = body.segments();
+
+    if (sendfile_segment_ == segments.size()) {
+        if (body.tail().empty()) {
+            return on_write_file(keep_alive, {}, 0);
+        }
+
+        net::async_write(
+            stream_,
+            net::buffer(body.tail()),
+            beast::bind_front_handler(
+                &HTTPSession::on_write_file,
+                shared_from_this(),
+                keep_alive));
+        return;
+    }
+
+    auto const& segment = segments[sendfile_segment_];
+    sendfile_offset_ = segment.offset;
+    sendfile_remain_ = segment.size;
+
+    if (segment.head.empty()) {
+        return do_sendfile(keep_alive);
+    }
+
+    net::async_write(
+        stream_,
+        net::buffer(segment.head),
+        beast::bind_front_handler(
+            &HTTPSession::on_write_segment_head,
+            shared_from_this(),
+            keep_alive));
+}
+
+void HTTPSession::on_write_segment_head(bool keep_alive, beast::error_code ec, std::size_t bytes_transferred)
+{
+    boost::ignore_unused(bytes_transferred);
+    do_sendfile(keep_alive, ec);
+}
+
+void HTTPSession::do_sendfile(bool keep_alive, beast::error_code ec)
+{
+    if (sendfile_waiting_) {
+        sendfile_waiting_ = false;
+        sendfile_timer_.cancel();
+    }
+
+    if (ec) {
+        file_serializer_.reset();
+        return fail(ec, "write");
+    }
+
+    auto& body = response_queue_.front().file()->body();
+    int const out_fd = stream_.socket().native_handle();
+    int const in_fd = body.file().native_handle();
+
+    while (sendfile_remain_ > 0) {
+        auto offset = static_cast<off_t>(sendfile_offset_);
+        auto const n = ::sendfile(out_fd, in_fd, &offset, static_cast<std::size_t>(std::min<std::uint64_t>(sendfile_remain_, 1 << 30)));
+
+        if (n > 0) {
+            sendfile_offset_ += static_cast<std::uint64_t>(n);
+            sendfile_remain_ -= static_cast<std::uint64_t>(n);
+            continue;
+        }
+
+        if (n < 0 && errno == EINTR) continue;
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // socket buffer is full; resume when it drains. The timer
+            // starts over after every wait, so it measures the time since
+            // the last chunk was sent.
+            sendfile_waiting_ = true;
+            sendfile_timer_.expires_after(sendfile_idle_timeout);
+            sendfile_timer_.async_wait(
+                beast::bind_front_handler(
+                    &HTTPSession::on_sendfile_timeout,
+                    shared_from_this()));
+
+            stream_.socket().async_wait(
+                tcp::socket::wait_write,
+                beast::bind_front_handler(
+                    &HTTPSession::do_sendfile,
+                    shared_from_this(),
+                    keep_alive));
+            return;
+        }
+
+        file_serializer_.reset();
+
+        if (n == 0) {
+            // the file was truncated; the promised Content-Length can not be met
+            return fail(http::error::short_read, "sendfile");
+        }
+        return fail(beast::error_code{errno, boost::system::system_category()}, "sendfile");
+    }
+
+    ++sendfile_segment_;
+    do_write_segment(keep_alive);
+}
+
+void HTTPSession::on_sendfile_timeout(beast::error_code ec)
+{
+    // the wait may have completed just before the timer was cancelled
+    if (ec || !sendfile_waiting_ || sendfile_timer_.expiry() > std::chrono::steady_clock::now()) return;
+
+    // the pending wait completes with operation_aborted
+    stream_.socket().close(ec);
+}
+
+void HTTPSession::on_write_file(bool keep_alive, beast::error_code ec, std::size_t bytes_transferred)
+{
+    sendfile_timer_.cancel();
+    file_serializer_.reset();
+    on_write(keep_alive, ec, bytes_transferred);
+}
+
+#endif
+
 }
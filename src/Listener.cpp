@@ -7,11 +7,12 @@
 namespace vein {
 
 Listener::Listener(
-    net::io_context& ioc, tcp::endpoint endpoint, std::unique_ptr<Router> router
+    net::io_context& ioc, tcp::endpoint endpoint, Router* router, ListenerOptions const& options
 )
     : ioc_(ioc)
-    , acceptor_(net::make_strand(ioc))
-    , router_(std::move(router))
+    , options_(options)
+    , acceptor_(make_executor())
+    , router_(router)
 {
     beast::error_code ec;
 
@@ -29,6 +30,18 @@ Listener::Listener(
         return;
     }
 
+    if (options_.reuse_port) {
+#ifdef SO_REUSEPORT
+        acceptor_.set_option(net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), ec);
+#else
+        ec = net::error::operation_not_supported;
+#endif
+        if (ec) {
+            fail(ec, "set_option");
+            return;
+        }
+    }
+
     // Bind to the server address
     acceptor_.bind(endpoint, ec);
     if (ec) {
@@ -56,7 +69,7 @@ void Listener::on_accept(beast::error_code ec, tcp::socket socket)
         // Create the http session and run it
         std::make_shared<HTTPSession>(
             std::move(socket),
-            router_.get()
+            router_
         )->run();
     }
 
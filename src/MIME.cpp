@@ -0,0 +1,327 @@
+﻿#include "pch.h"
+
+#include "vein/MIME.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+
+namespace vein {
+
+namespace {
+
+struct BuiltinType
+{
+    std::string_view extension; // lowercase, without the dot
+    MIME mime;
+};
+
+constexpr BuiltinType builtin_types[]{
+    {"htm",   {"text/html; charset=utf-8"}},
+    {"html",  {"text/html; charset=utf-8"}},
+    {"php",   {"text/html; charset=utf-8"}},
+    {"css",   {"text/css; charset=utf-8"}},
+    {"txt",   {"text/plain; charset=utf-8"}},
+    {"csv",   {"text/csv; charset=utf-8"}},
+    {"md",    {"text/markdown; charset=utf-8"}},
+    {"js",    {"application/javascript; charset=utf-8"}},
+    {"mjs",   {"application/javascript; charset=utf-8"}},
+    {"json",  {"application/json; charset=utf-8"}},
+    {"map",   {"application/json; charset=utf-8"}},
+    {"webmanifest", {"application/manifest+json; charset=utf-8"}},
+    {"xml",   {"application/xml; charset=utf-8"}},
+    {"rss",   {"application/rss+xml; charset=utf-8"}},
+    {"atom",  {"application/atom+xml; charset=utf-8"}},
+    {"wasm",  {"application/wasm"}},
+    {"pdf",   {"application/pdf"}},
+    {"zip",   {"application/zip", true}},
+    {"gz",    {"application/gzip", true}},
+    {"br",    {"application/x-brotli", true}},
+    {"zst",   {"application/zstd", true}},
+    {"flv",   {"video/x-flv", true}},
+    {"mp4",   {"video/mp4", true}},
+    {"webm",  {"video/webm", true}},
+    {"mp3",   {"audio/mpeg", true}},
+    {"ogg",   {"audio/ogg", true}},
+    {"wav",   {"audio/wav"}},
+    {"png",   {"image/png", true}},
+    {"jpe",   {"image/jpeg", true}},
+    {"jpeg",  {"image/jpeg", true}},
+    {"jpg",   {"image/jpeg", true}},
+    {"gif",   {"image/gif", true}},
+    {"webp",  {"image/webp", true}},
+    {"avif",  {"image/avif", true}},
+    {"bmp",   {"image/bmp"}},
+    {"ico",   {"image/vnd.microsoft.icon", true}},
+    {"tiff",  {"image/tiff", true}},
+    {"tif",   {"image/tiff", true}},
+    {"svg",   {"image/svg+xml"}},
+    {"svgz",  {"image/svg+xml"}},
+    {"woff",  {"font/woff", true}},
+    {"woff2", {"font/woff2", true}},
+    {"ttf",   {"font/ttf"}},
+    {"otf",   {"font/otf"}},
+};
+
+constexpr MIME default_mime{"application/text"};
+
+constexpr char to_lower_ascii(char c) noexcept
+{
+    return ('A' <= c && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+constexpr bool iequals_lower(std::string_view s, std::string_view lower) noexcept
+{
+    return std::ranges::equal(s, lower, [](char a, char b) { return to_lower_ascii(a) == b; });
+}
+
+// FNV-1a over the case-folded bytes
+constexpr std::uint32_t hash_extension(std::string_view extension, std::uint32_t seed) noexcept
+{
+    std::uint32_t h = 2166136261u ^ seed;
+    for (char const c : extension) {
+        h ^= static_cast<unsigned char>(to_lower_ascii(c));
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Collision-free table over the builtin extensions: the seed is searched
+// at compile time, so a lookup is one hash, one load and one comparison
+struct PerfectHashTable
+{
+    static constexpr std::size_t size = 512;
+    static_assert(std::size(builtin_types) < 255);
+    static_assert(std::size(builtin_types) * 4 < size);
+
+    std::uint32_t seed = 0;
+    std::array<std::uint8_t, size> slots{}; // index + 1; 0 is empty
+
+    [[nodiscard]] constexpr std::size_t slot_of(std::string_view extension) const noexcept
+    {
+        return hash_extension(extension, seed) & (size - 1);
+    }
+
+    [[nodiscard]] constexpr MIME const* find(std::string_view extension) const noexcept
+    {
+        auto const index = slots[slot_of(extension)];
+        if (index == 0) return nullptr;
+
+        auto const& entry = builtin_types[index - 1];
+        if (!iequals_lower(extension, entry.extension)) return nullptr;
+        return &entry.mime;
+    }
+};
+
+constexpr PerfectHashTable make_perfect_hash_table()
+{
+    for (std::uint32_t seed = 0;; ++seed) {
+        PerfectHashTable table{seed};
+        bool collided = false;
+
+        for (std::size_t i = 0; i < std::size(builtin_types); ++i) {
+            auto& slot = table.slots[table.slot_of(builtin_types[i].extension)];
+            if (slot != 0) {
+                collided = true;
+                break;
+            }
+            slot = static_cast<std::uint8_t>(i + 1);
+        }
+        if (!collided) return table;
+    }
+}
+
+constexpr auto builtin_table = make_perfect_hash_table();
+
+static_assert(builtin_table.find("html")->type == "text/html; charset=utf-8");
+static_assert(builtin_table.find("PNG")->is_already_compressed);
+static_assert(builtin_table.find("nope") == nullptr);
+
+
+struct StringHash
+{
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+// Extensions added at startup; consulted before the builtin table so that
+// they can override it
+struct CustomTypes
+{
+    std::unordered_set<std::string, StringHash, std::equal_to<>> types; // node-based; views into it stay valid
+    std::unordered_map<std::string, MIME, StringHash, std::equal_to<>> by_extension; // lowercase keys
+    std::size_t max_extension_size = 0;
+};
+
+CustomTypes& custom_types()
+{
+    static CustomTypes instance;
+    return instance;
+}
+
+constexpr std::string_view strip_dot(std::string_view extension) noexcept
+{
+    if (extension.starts_with('.')) extension.remove_prefix(1);
+    return extension;
+}
+
+bool guess_already_compressed(std::string_view type) noexcept
+{
+    if (type.starts_with("image/")) {
+        return !type.starts_with("image/svg") && !type.starts_with("image/bmp") && !type.starts_with("image/x-icon");
+    }
+    if (type.starts_with("video/") || type.starts_with("audio/")) {
+        return !type.starts_with("audio/wav") && !type.starts_with("audio/x-wav");
+    }
+    return
+        type == "font/woff" || type == "font/woff2" ||
+        type == "application/zip" || type == "application/gzip" ||
+        type == "application/zstd" || type == "application/x-brotli" ||
+        type == "application/x-7z-compressed" || type == "application/x-xz" ||
+        type == "application/x-bzip2" || type == "application/vnd.rar";
+}
+
+// Types served with "; charset=utf-8" by the built-in table
+bool is_textual(std::string_view type) noexcept
+{
+    return
+        type.starts_with("text/") ||
+        type.ends_with("+json") || type.ends_with("+xml") ||
+        type == "application/javascript" || type == "application/json" || type == "application/xml";
+}
+
+} // anon
+
+
+MIME mime_type_for_extension(std::string_view extension) noexcept
+{
+    extension = strip_dot(extension);
+
+    if (auto const& custom = custom_types(); !custom.by_extension.empty() && extension.size() <= custom.max_extension_size) {
+        std::array<char, 64> buf;
+        if (extension.size() <= buf.size()) {
+            std::ranges::transform(extension, buf.begin(), to_lower_ascii);
+
+            if (auto const it = custom.by_extension.find(std::string_view{buf.data(), extension.size()}); it != custom.by_extension.end()) {
+                return it->second;
+            }
+        }
+    }
+
+    if (auto const* mime = builtin_table.find(extension)) {
+        return *mime;
+    }
+    return default_mime;
+}
+
+MIME mime_type(std::filesystem::path const& path) noexcept
+{
+    using char_type = std::filesystem::path::value_type;
+
+    // same as path.extension(), without constructing a path
+    std::basic_string_view<char_type> name = path.native();
+#ifdef BOOST_MSVC
+    if (auto const sep = name.find_last_of(L"/\\"); sep != name.npos) name.remove_prefix(sep + 1);
+#else
+    if (auto const sep = name.find_last_of('/'); sep != name.npos) name.remove_prefix(sep + 1);
+#endif
+
+    auto const dot = name.find_last_of(char_type{'.'});
+    if (dot == name.npos || dot == 0) return default_mime; // no extension, or ".bashrc"
+
+    auto const extension = name.substr(dot + 1);
+
+#ifdef BOOST_MSVC
+    // extensions in the table are ASCII
+    std::array<char, 64> buf;
+    if (extension.size() > buf.size()) return default_mime;
+
+    for (std::size_t i = 0; i < extension.size(); ++i) {
+        if (extension[i] > 0x7f) return default_mime;
+        buf[i] = static_cast<char>(extension[i]);
+    }
+    return mime_type_for_extension({buf.data(), extension.size()});
+#else
+    return mime_type_for_extension(extension);
+#endif
+}
+
+void add_mime_type(std::string_view extension, std::string_view type, bool is_already_compressed)
+{
+    extension = strip_dot(extension);
+    if (extension.empty()) {
+        throw std::invalid_argument{"empty file extension"};
+    }
+
+    auto& custom = custom_types();
+
+    std::string key{extension};
+    std::ranges::transform(key, key.begin(), to_lower_ascii);
+
+    auto const type_it = custom.types.emplace(type).first;
+    custom.by_extension.insert_or_assign(std::move(key), MIME{*type_it, is_already_compressed});
+    custom.max_extension_size = std::max(custom.max_extension_size, extension.size());
+}
+
+void add_mime_type(std::string_view extension, std::string_view type)
+{
+    add_mime_type(extension, type, guess_already_compressed(type));
+}
+
+std::size_t load_mime_types(std::filesystem::path const& path)
+{
+    std::ifstream file{path};
+    if (!file) {
+        throw std::invalid_argument{"mime.types file does not exist: " + path.string()};
+    }
+
+    constexpr std::string_view whitespace = " \t\r";
+    std::size_t count = 0;
+
+    for (std::string line; std::getline(file, line);) {
+        std::string_view rest = line;
+        if (auto const hash = rest.find('#'); hash != rest.npos) {
+            rest = rest.substr(0, hash);
+        }
+
+        // nginx style: "types {", "}" and a trailing ";"
+        if (auto const semicolon = rest.find(';'); semicolon != rest.npos) {
+            rest = rest.substr(0, semicolon);
+        }
+
+        auto const next_token = [&] {
+            auto const first = rest.find_first_not_of(whitespace);
+            if (first == rest.npos) {
+                rest = {};
+                return std::string_view{};
+            }
+            rest.remove_prefix(first);
+            auto const last = std::min(rest.find_first_of(whitespace), rest.size());
+            auto const token = rest.substr(0, last);
+            rest.remove_prefix(last);
+            return token;
+        };
+
+        auto const type = next_token();
+        if (type.find('/') == type.npos) continue;
+
+        // mime.types has no parameters; keep the charset of the built-in
+        // types, so that overriding e.g. "html" keeps its Content-Type
+        std::string const full_type = is_textual(type) ? std::string{type} + "; charset=utf-8" : std::string{type};
+
+        for (auto extension = next_token(); !extension.empty(); extension = next_token()) {
+            add_mime_type(extension, full_type, guess_already_compressed(type));
+            ++count;
+        }
+    }
+    return count;
+}
+
+}
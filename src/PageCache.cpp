@@ -0,0 +1,182 @@
+﻿#include "pch.h"
+
+#include "vein/PageCache.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+
+namespace vein {
+
+std::string PageCache::make_key(std::string_view target, ContentEncoding encoding)
+{
+    std::string key;
+    key.reserve(target.size() + 16);
+    key += target;
+    key += '\0';
+    key += to_string(encoding);
+    return key;
+}
+
+void PageCache::append_vary_value(std::string& key, std::string_view value)
+{
+    // request-targets and field values never contain NUL
+    key += '\0';
+    key += value;
+}
+
+PageCache::EntryPtr PageCache::find(std::string_view key) const
+{
+    std::shared_lock lock{mtx_};
+
+    auto const it = entries_.find(key);
+    if (it == entries_.end()) return nullptr;
+
+    auto const& slot = it->second;
+    if (std::max(slot.entry->expires, slot.entry->stale_expires) <= clock_type::now()) return nullptr;
+
+    slot.referenced.store(true, std::memory_order_relaxed);
+    return slot.entry;
+}
+
+std::variant<PageCache::Flight, PageCache::FlightResult> PageCache::join_flight(std::string_view key)
+{
+    std::lock_guard lock{flight_mtx_};
+
+    if (auto const it = flights_.find(key); it != flights_.end()) {
+        return FlightResult{it->second};
+    }
+
+    Flight flight{*this, std::string{key}};
+    flights_.emplace(flight.key_, flight.state_);
+    return flight;
+}
+
+void PageCache::FlightResult::on_complete(std::function<void(EntryPtr)> handler) const
+{
+    {
+        std::lock_guard lock{state_->mtx};
+        if (!state_->done) {
+            state_->waiters.push_back(std::move(handler));
+            return;
+        }
+    }
+    handler(state_->entry);
+}
+
+void PageCache::Flight::complete(EntryPtr entry) noexcept
+{
+    if (!cache_) return;
+
+    // requests arriving from now on find the entry in the cache
+    {
+        std::lock_guard lock{cache_->flight_mtx_};
+        cache_->flights_.erase(key_);
+    }
+    std::vector<std::function<void(EntryPtr)>> waiters;
+    {
+        std::lock_guard lock{state_->mtx};
+        state_->done = true;
+        state_->entry = entry;
+        waiters.swap(state_->waiters);
+    }
+    cache_ = nullptr;
+
+    // outside the lock, since a handler may join another flight
+    for (auto& waiter : waiters) {
+        waiter(entry);
+    }
+}
+
+bool PageCache::insert(std::string key, EntryPtr entry, std::uint64_t generation)
+{
+    auto const size = entry_size(key, *entry);
+
+    std::unique_lock lock{mtx_};
+
+    if (size > byte_budget_ / 4) return false; // not worth evicting everything else
+
+    if (generation != generation_.load(std::memory_order_relaxed)) return false;
+
+    evict_locked(size);
+
+    auto& slot = entries_[std::move(key)];
+    bytes_used_ -= slot.size;
+    slot.entry = std::move(entry);
+    slot.size = size;
+    slot.referenced.store(false, std::memory_order_relaxed);
+    bytes_used_ += size;
+    return true;
+}
+
+void PageCache::invalidate(std::string_view target_prefix)
+{
+    std::unique_lock lock{mtx_};
+    generation_.fetch_add(1, std::memory_order_release);
+
+    std::erase_if(entries_, [&](auto const& kv) {
+        if (!kv.first.starts_with(target_prefix)) return false;
+        bytes_used_ -= kv.second.size;
+        return true;
+    });
+}
+
+void PageCache::clear()
+{
+    std::unique_lock lock{mtx_};
+    generation_.fetch_add(1, std::memory_order_release);
+    entries_.clear();
+    bytes_used_ = 0;
+}
+
+void PageCache::set_byte_budget(std::size_t byte_budget)
+{
+    std::unique_lock lock{mtx_};
+    byte_budget_ = byte_budget;
+    evict_locked(0);
+}
+
+std::size_t PageCache::byte_budget() const
+{
+    std::shared_lock lock{mtx_};
+    return byte_budget_;
+}
+
+std::size_t PageCache::bytes_used() const
+{
+    std::shared_lock lock{mtx_};
+    return bytes_used_;
+}
+
+std::size_t PageCache::entry_size(std::string_view key, Entry const& entry) noexcept
+{
+    // the header is small and its size is not exposed; count the body and key
+    return key.size() + entry.body.size() + sizeof(Entry);
+}
+
+void PageCache::evict_locked(std::size_t incoming)
+{
+    if (bytes_used_ + incoming <= byte_budget_) return;
+
+    auto const now = clock_type::now();
+    std::erase_if(entries_, [&](auto const& kv) {
+        if (std::max(kv.second.entry->expires, kv.second.entry->stale_expires) > now) return false;
+        bytes_used_ -= kv.second.size;
+        return true;
+    });
+
+    // Two CLOCK sweeps are enough: the first one clears every reference
+    // bit, so the second one evicts unconditionally.
+    for (int sweep = 0; sweep < 2 && bytes_used_ + incoming > byte_budget_; ++sweep) {
+        for (auto it = entries_.begin(); it != entries_.end() && bytes_used_ + incoming > byte_budget_;) {
+            if (it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+                ++it;
+                continue;
+            }
+            bytes_used_ -= it->second.size;
+            it = entries_.erase(it);
+        }
+    }
+}
+
+}
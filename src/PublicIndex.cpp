@@ -0,0 +1,210 @@
+﻿#include "pch.h"
+
+#include "vein/PublicIndex.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+#ifdef __linux__
+# include <fcntl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+# include <cerrno>
+# if __has_include(<linux/openat2.h>)
+#  include <linux/openat2.h>
+#  define VEIN_HAS_OPENAT2 1
+# endif
+#endif
+
+
+namespace vein {
+
+PublicIndex::PublicIndex(std::filesystem::path const& root)
+    : root_(std::filesystem::weakly_canonical(root))
+{
+#ifdef __linux__
+    root_fd_ = ::open(root_.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+#endif
+    rebuild();
+}
+
+PublicIndex::~PublicIndex()
+{
+#ifdef __linux__
+    if (root_fd_ >= 0) {
+        ::close(root_fd_);
+    }
+#endif
+}
+
+PublicIndex::EntryPtr PublicIndex::find(std::string_view rel_path) const
+{
+    std::shared_lock lock{mtx_};
+    if (auto const it = entries_.find(rel_path); it != entries_.end()) {
+        return it->second;
+    }
+    return nullptr;
+}
+
+PublicIndex::EntryPtr PublicIndex::resolve(std::string_view rel_path)
+{
+    if (auto entry = find(rel_path)) {
+        return entry;
+    }
+
+    auto entry = open_beneath(rel_path);
+    if (!entry) return nullptr;
+
+    // Keyed by the requested path, which may differ from the canonical one.
+    // Only the normal spelling is remembered, otherwise "a//b", "a/./b"...
+    // would let clients grow the index without bound.
+    if (std::filesystem::path{rel_path}.lexically_normal().generic_string() == rel_path) {
+        std::unique_lock lock{mtx_};
+        entries_.try_emplace(std::string{rel_path}, entry);
+    }
+    return entry;
+}
+
+void PublicIndex::refresh(std::filesystem::path const& path)
+{
+    auto const key = key_of(path);
+    if (!key) return;
+
+    if (key->empty()) {
+        return rebuild();
+    }
+
+    Entries fresh;
+    std::error_code ec;
+    if (std::filesystem::is_directory(path, ec)) {
+        scan(path, fresh);
+    } else if (auto entry = make_entry(path)) {
+        fresh.emplace(*key, std::move(entry));
+    }
+
+    auto const dir_prefix = *key + '/';
+
+    std::unique_lock lock{mtx_};
+
+    // `path` may have been a directory before, and entries resolved
+    // through symlinks may point into it, so every dependent key goes
+    std::erase_if(entries_, [&](auto const& kv) {
+        return
+            kv.first == *key || kv.first.starts_with(dir_prefix) ||
+            std::ranges::mismatch(path, kv.second->path).in1 == path.end();
+    });
+    entries_.merge(fresh);
+}
+
+void PublicIndex::rebuild()
+{
+    Entries fresh;
+    scan(root_, fresh);
+
+    std::unique_lock lock{mtx_};
+    entries_ = std::move(fresh);
+}
+
+std::size_t PublicIndex::size() const
+{
+    std::shared_lock lock{mtx_};
+    return entries_.size();
+}
+
+std::optional<std::string> PublicIndex::key_of(std::filesystem::path const& path) const
+{
+    auto const [root_end, path_it] = std::ranges::mismatch(root_, path);
+    if (root_end != root_.end()) return std::nullopt;
+
+    std::string key;
+    for (auto it = path_it; it != path.end(); ++it) {
+        if (it->empty()) continue;
+        if (!key.empty()) key += '/';
+        key += it->generic_string();
+    }
+    return key;
+}
+
+PublicIndex::EntryPtr PublicIndex::make_entry(std::filesystem::path const& path) const
+{
+    std::error_code ec;
+    auto canonical_path = std::filesystem::canonical(path, ec);
+    if (ec) return nullptr;
+
+    // a symlink pointing outside of the root
+    if (std::ranges::mismatch(root_, canonical_path).in1 != root_.end()) return nullptr;
+
+    auto const info = file_info(canonical_path);
+    if (!info) return nullptr;
+
+    auto entry = std::make_shared<Entry>();
+    entry->mime = mime_type(canonical_path);
+    entry->info = *info;
+    entry->path = std::move(canonical_path);
+    return entry;
+}
+
+PublicIndex::EntryPtr PublicIndex::open_beneath(std::string_view rel_path) const
+{
+#if VEIN_HAS_OPENAT2
+    if (root_fd_ >= 0) {
+        open_how how{};
+        how.flags = O_PATH | O_CLOEXEC;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+        std::string const rel{rel_path};
+        int const fd = static_cast<int>(::syscall(SYS_openat2, root_fd_, rel.c_str(), &how, sizeof(how)));
+
+        if (fd >= 0) {
+            auto const info = file_info(fd);
+
+            std::error_code ec;
+            auto canonical_path = std::filesystem::read_symlink("/proc/self/fd/" + std::to_string(fd), ec);
+            ::close(fd);
+
+            if (!info || ec) return nullptr;
+
+            auto entry = std::make_shared<Entry>();
+            entry->mime = mime_type(canonical_path);
+            entry->info = *info;
+            entry->path = std::move(canonical_path);
+            return entry;
+        }
+
+        // older kernels lack openat2; fall through to the portable check
+        if (errno != ENOSYS) return nullptr;
+    }
+#endif
+
+    auto path = root_;
+    for (auto const& part : std::filesystem::path{rel_path}.lexically_normal()) {
+        if (part == ".." || part.has_root_path()) return nullptr;
+        path /= part;
+    }
+    return make_entry(path);
+}
+
+void PublicIndex::scan(std::filesystem::path const& dir, Entries& entries) const
+{
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator{dir, ec};
+        !ec && it != std::filesystem::recursive_directory_iterator{};
+        it.increment(ec)
+    ) {
+        if (!it->is_regular_file(ec)) continue;
+
+        auto const key = key_of(it->path());
+        if (!key) continue;
+
+        if (auto entry = make_entry(it->path())) {
+            entries.emplace(std::move(*key), std::move(entry));
+        }
+    }
+
+    if (ec) {
+        std::cerr << "warning: failed to scan " << dir << ": " << ec.message() << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,152 @@
+﻿#include "pch.h"
+
+#include "vein/Range.hpp"
+
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <random>
+
+
+namespace vein {
+
+namespace {
+
+constexpr std::string_view trim_ows(std::string_view s) noexcept
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+constexpr std::optional<std::uint64_t> parse_position(std::string_view s) noexcept
+{
+    if (s.empty()) return std::nullopt;
+
+    std::uint64_t res = 0;
+    for (char const c : s) {
+        if (c < '0' || '9' < c) return std::nullopt;
+        if (res > (std::numeric_limits<std::uint64_t>::max() - 9) / 10) return std::nullopt;
+        res = res * 10 + static_cast<std::uint64_t>(c - '0');
+    }
+    return res;
+}
+
+constexpr bool iequals(std::string_view a, std::string_view b) noexcept
+{
+    return std::ranges::equal(a, b, [](char x, char y) {
+        return (('A' <= x && x <= 'Z') ? x + ('a' - 'A') : x) == (('A' <= y && y <= 'Z') ? y + ('a' - 'A') : y);
+    });
+}
+
+std::string make_boundary()
+{
+    thread_local std::mt19937_64 engine{std::random_device{}()};
+    return std::format("vein-{:016x}{:016x}", engine(), engine());
+}
+
+} // anon
+
+std::optional<std::vector<ByteRange>> parse_byte_ranges(std::string_view field_value, std::uint64_t size)
+{
+    field_value = trim_ows(field_value);
+
+    auto const eq = field_value.find('=');
+    if (eq == std::string_view::npos || !iequals(trim_ows(field_value.substr(0, eq)), "bytes")) {
+        // unknown range unit
+        return std::nullopt;
+    }
+    field_value.remove_prefix(eq + 1);
+
+    std::vector<ByteRange> ranges;
+    std::size_t spec_count = 0;
+
+    while (!field_value.empty()) {
+        auto const comma = field_value.find(',');
+        auto const spec = trim_ows(field_value.substr(0, comma));
+        field_value.remove_prefix(comma == std::string_view::npos ? field_value.size() : comma + 1);
+
+        // empty list elements are allowed
+        if (spec.empty()) continue;
+        if (++spec_count > max_byte_ranges) return std::nullopt;
+
+        auto const dash = spec.find('-');
+        if (dash == std::string_view::npos) return std::nullopt;
+
+        if (dash == 0) {
+            // suffix-range: the last N bytes
+            auto const suffix = parse_position(spec.substr(1));
+            if (!suffix) return std::nullopt;
+            if (*suffix == 0 || size == 0) continue;
+
+            ranges.push_back({size - std::min(*suffix, size), size - 1});
+            continue;
+        }
+
+        auto const first = parse_position(spec.substr(0, dash));
+        if (!first) return std::nullopt;
+
+        std::uint64_t last = std::numeric_limits<std::uint64_t>::max();
+        if (dash + 1 < spec.size()) {
+            auto const last_pos = parse_position(spec.substr(dash + 1));
+            if (!last_pos || *last_pos < *first) return std::nullopt;
+            last = *last_pos;
+        }
+
+        if (*first >= size) continue; // unsatisfiable
+        ranges.push_back({*first, std::min(last, size - 1)});
+    }
+
+    if (spec_count == 0) return std::nullopt;
+    if (ranges.size() < 2) return ranges;
+
+    std::ranges::sort(ranges, {}, &ByteRange::first);
+
+    std::vector<ByteRange> merged;
+    merged.reserve(ranges.size());
+    merged.push_back(ranges.front());
+
+    for (auto const& range : std::span{ranges}.subspan(1)) {
+        auto& back = merged.back();
+        if (range.first <= back.last + 1) {
+            back.last = std::max(back.last, range.last);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
+std::string content_range(ByteRange const& range, std::uint64_t size)
+{
+    return std::format("bytes {}-{}/{}", range.first, range.last, size);
+}
+
+std::string set_byteranges(FileBody::value_type& body, std::span<ByteRange const> ranges, std::string_view content_type)
+{
+    auto const boundary = make_boundary();
+    auto const size = body.file_size();
+
+    body.clear_segments();
+
+    bool first = true;
+    for (auto const& range : ranges) {
+        body.add_segment(
+            std::format(
+                "{}--{}\r\nContent-Type: {}\r\nContent-Range: {}\r\n\r\n",
+                first ? "" : "\r\n",
+                boundary,
+                content_type,
+                content_range(range, size)
+            ),
+            range.first,
+            range.size()
+        );
+        first = false;
+    }
+    body.set_tail(std::format("\r\n--{}--\r\n", boundary));
+
+    return std::format("multipart/byteranges; boundary={}", boundary);
+}
+
+}
@@ -0,0 +1,102 @@
+﻿#include "pch.h"
+
+#include "vein/RequestBody.hpp"
+
+#include <cerrno>
+#include <cstdio>
+
+#ifdef __linux__
+# include <sys/mman.h>
+#endif
+
+
+namespace vein {
+
+RequestBody::value_type::~value_type() = default;
+
+#ifdef __linux__
+
+void RequestBody::value_type::Unmap::operator()(char* p) const noexcept
+{
+    ::munmap(p, size);
+}
+
+#endif
+
+void RequestBody::value_type::reserve(std::uint64_t size, beast::error_code& ec)
+{
+    if (size > memory_limit_) {
+        spill(ec);
+        return;
+    }
+    memory_.reserve(static_cast<std::size_t>(size));
+}
+
+void RequestBody::value_type::append(char const* data, std::size_t size, beast::error_code& ec)
+{
+    if (!spilled() && memory_.size() + size > memory_limit_) {
+        spill(ec);
+        if (ec) return;
+    }
+
+    if (spilled()) {
+        file_.write(data, size, ec);
+        if (ec) return;
+    } else {
+        memory_.append(data, size);
+    }
+    size_ += size;
+}
+
+void RequestBody::value_type::spill(beast::error_code& ec)
+{
+    // removed by the system once closed, even if the process dies
+    std::FILE* f = std::tmpfile();
+    if (!f) {
+        ec = {errno, boost::system::generic_category()};
+        return;
+    }
+    file_.native_handle(f);
+
+    if (!memory_.empty()) {
+        file_.write(memory_.data(), memory_.size(), ec);
+        if (ec) return;
+    }
+    std::string{}.swap(memory_);
+}
+
+std::string_view RequestBody::value_type::view() const
+{
+    if (!spilled()) return memory_;
+    if (size_ == 0) return {};
+
+#ifdef __linux__
+    if (!mapping_) {
+        std::fflush(file_.native_handle());
+
+        auto const size = static_cast<std::size_t>(size_);
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, ::fileno(file_.native_handle()), 0);
+        if (p == MAP_FAILED) {
+            throw beast::system_error{beast::error_code{errno, boost::system::generic_category()}};
+        }
+        mapping_ = std::unique_ptr<char, Unmap>{static_cast<char*>(p), Unmap{size}};
+    }
+    return {mapping_.get(), static_cast<std::size_t>(size_)};
+
+#else
+    if (loaded_.empty()) {
+        loaded_.resize(static_cast<std::size_t>(size_));
+
+        beast::error_code ec;
+        file_.seek(0, ec);
+        if (!ec) file_.read(loaded_.data(), loaded_.size(), ec);
+        if (ec) {
+            loaded_.clear();
+            throw beast::system_error{ec};
+        }
+    }
+    return loaded_;
+#endif
+}
+
+}
@@ -3,25 +3,178 @@
 #include "vein/Router.hpp"
 #include "vein/Controller.hpp"
 
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
 
 namespace vein {
 
 Router::Router(std::filesystem::path const& public_root)
     : public_root_(public_root)
-{}
+{
+    std::error_code ec;
+    auto root = std::filesystem::canonical(public_root_, ec);
+    if (ec) return;
+
+    public_index_ = std::make_unique<PublicIndex>(root);
+
+    // cache keys are canonical, so watch the canonical root
+    public_root_watcher_ = std::make_unique<FileWatcher>(std::move(root), [this](std::filesystem::path const& changed) {
+        public_index_->refresh(changed);
+        static_cache_.invalidate(changed);
+    });
+}
 
 Router::~Router() = default;
 
 void Router::route(PathMatcher matcher, std::unique_ptr<Controller> controller)
 {
     controller->set_router(this);
-    controller->clear_local_doc();
 
-    controllers_.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(std::move(matcher)),
-        std::forward_as_tuple(std::move(controller))
-    );
+    routes_.insert(matcher, controller.get());
+    controllers_.push_back(std::move(controller));
+}
+
+void Router::route(PathMatcher matcher, std::unique_ptr<Controller> controller, CompressionOptions const& compression)
+{
+    controller->set_compression_options(compression);
+    route(std::move(matcher), std::move(controller));
+}
+
+RequestBodyOptions Router::request_body_options(http::request_header<> const& header) const
+{
+    // what files and unknown paths accept, which is nothing of note
+    static constexpr RequestBodyOptions default_options{.limit = 10000, .memory_limit = 10000};
+
+    if (header.method() == http::verb::get || header.method() == http::verb::head) {
+        return default_options;
+    }
+
+    auto const url = boost::urls::parse_origin_form(header.target());
+    if (!url) return default_options;
+
+    if (auto const match = routes_.match(decoded_path(*url))) {
+        return (*match.value)->request_body_options();
+    }
+    return default_options;
+}
+
+std::string_view Router::decoded_path(boost::urls::url_view const& url)
+{
+    thread_local std::string buf;
+
+    auto const path = *url.encoded_path();
+    buf.assign(path.begin(), path.end());
+    return buf;
+}
+
+void Router::set_static_compression_options(std::string prefix, CompressionOptions const& options)
+{
+    auto const it = std::ranges::find(static_compression_, prefix, &decltype(static_compression_)::value_type::first);
+    if (it != static_compression_.end()) {
+        it->second = options;
+        return;
+    }
+
+    auto const pos = std::ranges::find_if(static_compression_, [&](auto const& entry) {
+        return entry.first.size() < prefix.size();
+    });
+    static_compression_.emplace(pos, std::move(prefix), options);
+}
+
+CompressionOptions const& Router::static_compression_options(std::string_view rel_path) const noexcept
+{
+    for (auto const& [prefix, options] : static_compression_) {
+        if (rel_path.starts_with(prefix)) return options;
+    }
+    return static_compression_.back().second;
+}
+
+std::optional<FileInfo> Router::fresh_sidecar_info(FileInfo const& info, std::filesystem::path const& sidecar)
+{
+    auto sidecar_info = file_info(sidecar);
+    if (!sidecar_info || sidecar_info->mtime_ns < info.mtime_ns) {
+        return std::nullopt;
+    }
+    return sidecar_info;
+}
+
+std::size_t Router::precompress_public_root() const
+{
+    std::size_t written = 0;
+
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator{public_root_, ec};
+        !ec && it != std::filesystem::recursive_directory_iterator{};
+        it.increment(ec)
+    ) {
+        if (!it->is_regular_file(ec)) continue;
+
+        auto const& path = it->path();
+        if (mime_type(path).is_already_compressed) continue;
+
+        if (std::ranges::any_of(sidecar_encodings_v, [ext = path.extension()](ContentEncoding encoding) {
+            return ext == sidecar_extension(encoding);
+        })) {
+            continue;
+        }
+
+        auto const info = file_info(path);
+        auto const& compression = static_compression_options(path.lexically_relative(public_root_).generic_string());
+        if (info && info->size < compression.min_size) continue;
+
+        std::string contents;
+        bool loaded = false;
+
+        for (auto const encoding : sidecar_encodings_v) {
+            if (!encoders_.available().contains(encoding)) continue;
+
+            auto const sidecar = sidecar_path(path, encoding);
+            if (info && fresh_sidecar_info(*info, sidecar)) continue;
+
+            if (!loaded) {
+                std::ifstream ifs{path, std::ios::in | std::ios::binary};
+                contents.assign(std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{});
+                if (ifs.bad()) {
+                    std::cerr << "warning: failed to read " << path << std::endl;
+                    break;
+                }
+                loaded = true;
+            }
+
+            ByteBuffer compressed;
+            encoders_.compress(encoding, contents, compressed, compression);
+
+            if (compressed.size() >= contents.size()) {
+                // not worth it; make sure an outdated one is not left behind
+                std::filesystem::remove(sidecar, ec);
+                continue;
+            }
+
+            // write to a temporary file first so that requests never see a partial sidecar
+            auto tmp_path = sidecar;
+            tmp_path += ".tmp";
+            {
+                std::ofstream ofs{tmp_path, std::ios::out | std::ios::binary | std::ios::trunc};
+                ofs.write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+                if (!ofs) {
+                    std::cerr << "warning: failed to write " << tmp_path << std::endl;
+                    continue;
+                }
+            }
+            std::filesystem::rename(tmp_path, sidecar, ec);
+            if (ec) {
+                std::cerr << "warning: failed to write " << sidecar << ": " << ec.message() << std::endl;
+                std::filesystem::remove(tmp_path, ec);
+                continue;
+            }
+            ++written;
+        }
+        ec.clear();
+    }
+    return written;
 }
 
 }
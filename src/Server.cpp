@@ -6,26 +6,62 @@
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <boost/asio/thread_pool.hpp>
 
 #include <cstdlib>
 #include <csignal>
+#include <iostream>
+#include <stdexcept>
 #include <thread>
+#include <vector>
+
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+#endif
 
 
 namespace vein {
 
 using tcp = boost::asio::ip::tcp;
 
-int Server::wait(std::string const& host, unsigned port, std::unique_ptr<Router> router, unsigned thread_count)
+namespace {
+
+// Pins the calling thread to the `index`th CPU it is allowed to run on,
+// wrapping around if there are fewer
+void pin_to_core(unsigned index)
+{
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+
+    auto const count = CPU_COUNT(&allowed);
+    if (count == 0) return;
+
+    auto target = static_cast<int>(index % static_cast<unsigned>(count));
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        if (target-- > 0) continue;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        return;
+    }
+#else
+    (void)index;
+#endif
+}
+
+int run_shared(tcp::endpoint const& endpoint, Router& router, unsigned thread_count)
 {
     net::io_context ioc{static_cast<int>(thread_count)};
+    router.set_background_executor(ioc.get_executor());
 
     // Create and launch a listening port
-    auto l = std::make_shared<Listener>(
-        ioc,
-        tcp::endpoint{net::ip::make_address(host), static_cast<net::ip::port_type>(port)},
-        std::move(router)
-    );
+    auto l = std::make_shared<Listener>(ioc, endpoint, &router);
     l->run();
 
     // Capture SIGINT and SIGTERM to perform a clean shutdown
@@ -56,4 +92,84 @@ int Server::wait(std::string const& host, unsigned port, std::unique_ptr<Router>
     return EXIT_SUCCESS;
 }
 
+int run_sharded(tcp::endpoint const& endpoint, Router& router, unsigned thread_count)
+{
+    // Single-threaded contexts skip the locking of the scheduler
+    std::vector<std::unique_ptr<net::io_context>> shards;
+    shards.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i) {
+        shards.push_back(std::make_unique<net::io_context>(1));
+    }
+
+    // The router is shared by all shards. Stale pages are refreshed on a
+    // thread of their own, which no connection waits for.
+    net::thread_pool background{1};
+    router.set_background_executor(background.get_executor());
+
+    // Every shard accepts on its own socket, and its sessions stay on
+    // its thread, so they need no strands
+    ListenerOptions const options{
+        .reuse_port = true,
+        .strand_per_session = false,
+    };
+
+    std::vector<std::shared_ptr<Listener>> listeners;
+    listeners.reserve(thread_count);
+    for (auto& shard : shards) {
+        listeners.push_back(std::make_shared<Listener>(*shard, endpoint, &router, options));
+        listeners.back()->run();
+    }
+
+    // Capture SIGINT and SIGTERM to perform a clean shutdown
+    net::signal_set signals(*shards.front(), SIGINT, SIGTERM);
+    signals.async_wait([&](beast::error_code const&, int) {
+        for (auto& shard : shards) {
+            shard->stop();
+        }
+        background.stop();
+    });
+
+    std::vector<std::thread> v;
+    v.reserve(thread_count - 1);
+
+    for (unsigned i = 1; i < thread_count; ++i) {
+        v.emplace_back([&shard = *shards[i], i] {
+            pin_to_core(i);
+            shard.run();
+        });
+    }
+    pin_to_core(0);
+    shards.front()->run();
+
+    // (If we get here, it means we got a SIGINT or SIGTERM)
+
+    // Block until all the threads exit
+    for (auto& t : v) {
+        t.join();
+    }
+    background.join();
+
+    return EXIT_SUCCESS;
+}
+
+} // anon
+
+int Server::wait(std::string const& host, unsigned port, std::unique_ptr<Router> router, unsigned thread_count, ThreadingModel model)
+{
+    if (thread_count == 0) {
+        throw std::invalid_argument{"thread_count must be at least 1"};
+    }
+
+    tcp::endpoint const endpoint{net::ip::make_address(host), static_cast<net::ip::port_type>(port)};
+
+    if (model == ThreadingModel::shard_per_core) {
+#ifdef SO_REUSEPORT
+        return run_sharded(endpoint, *router, thread_count);
+#else
+        std::cerr << "warning: SO_REUSEPORT is not supported on this platform; falling back to a shared io_context" << std::endl;
+#endif
+    }
+    return run_shared(endpoint, *router, thread_count);
+}
+
 }
@@ -0,0 +1,112 @@
+﻿#include "pch.h"
+
+#include "vein/StaticCache.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+
+namespace vein {
+
+StaticCache::EntryPtr StaticCache::find(std::filesystem::path const& canonical_path, ContentEncoding encoding) const
+{
+    std::shared_lock lock{mtx_};
+
+    auto const it = entries_.find(canonical_path);
+    if (it == entries_.end()) return nullptr;
+
+    auto const& slot = it->second[std::to_underlying(encoding)];
+    slot.referenced.store(true, std::memory_order_relaxed);
+    return slot.entry;
+}
+
+void StaticCache::insert(std::filesystem::path const& canonical_path, EntryPtr entry, std::uint64_t generation)
+{
+    auto const size = entry->body.size();
+
+    std::unique_lock lock{mtx_};
+
+    if (size > byte_budget_ / 4) return; // not worth evicting everything else
+
+    if (generation != generation_.load(std::memory_order_relaxed)) return;
+
+    evict_locked(size);
+
+    auto& slot = entries_[canonical_path][std::to_underlying(entry->encoding)];
+    if (slot.entry) {
+        bytes_used_ -= slot.entry->body.size();
+    }
+    slot.entry = std::move(entry);
+    slot.referenced.store(false, std::memory_order_relaxed);
+    bytes_used_ += size;
+}
+
+void StaticCache::invalidate(std::filesystem::path const& path)
+{
+    std::unique_lock lock{mtx_};
+    generation_.fetch_add(1, std::memory_order_release);
+
+    std::erase_if(entries_, [&](auto const& kv) {
+        auto const& [key, slots] = kv;
+        if (std::mismatch(path.begin(), path.end(), key.begin(), key.end()).first != path.end()) {
+            return false;
+        }
+        for (auto const& slot : slots) {
+            if (slot.entry) bytes_used_ -= slot.entry->body.size();
+        }
+        return true;
+    });
+}
+
+void StaticCache::clear()
+{
+    std::unique_lock lock{mtx_};
+    generation_.fetch_add(1, std::memory_order_release);
+    entries_.clear();
+    bytes_used_ = 0;
+}
+
+void StaticCache::set_byte_budget(std::size_t byte_budget)
+{
+    std::unique_lock lock{mtx_};
+    byte_budget_ = byte_budget;
+    evict_locked(0);
+}
+
+std::size_t StaticCache::byte_budget() const
+{
+    std::shared_lock lock{mtx_};
+    return byte_budget_;
+}
+
+std::size_t StaticCache::bytes_used() const
+{
+    std::shared_lock lock{mtx_};
+    return bytes_used_;
+}
+
+void StaticCache::evict_locked(std::size_t incoming)
+{
+    // Two CLOCK sweeps are enough: the first one clears every reference
+    // bit, so the second one evicts unconditionally.
+    for (int sweep = 0; sweep < 2 && bytes_used_ + incoming > byte_budget_; ++sweep) {
+        for (auto it = entries_.begin(); it != entries_.end() && bytes_used_ + incoming > byte_budget_;) {
+            bool empty = true;
+
+            for (auto& slot : it->second) {
+                if (!slot.entry) continue;
+
+                if (slot.referenced.exchange(false, std::memory_order_relaxed)) {
+                    empty = false;
+                    continue;
+                }
+                bytes_used_ -= slot.entry->body.size();
+                slot.entry.reset();
+            }
+
+            it = empty ? entries_.erase(it) : std::next(it);
+        }
+    }
+}
+
+}
@@ -0,0 +1,123 @@
+﻿#include "pch.h"
+
+#include "vein/Validators.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+
+
+namespace vein {
+
+namespace {
+
+constexpr std::array<std::string_view, 7> weekday_names{"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+constexpr std::array<std::string_view, 12> month_names{"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+constexpr std::string_view trim_ows(std::string_view s) noexcept
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+constexpr std::optional<int> parse_digits(std::string_view s) noexcept
+{
+    int res = 0;
+    for (char const c : s) {
+        if (c < '0' || '9' < c) return std::nullopt;
+        res = res * 10 + (c - '0');
+    }
+    return res;
+}
+
+constexpr std::string_view opaque_tag(std::string_view etag) noexcept
+{
+    if (etag.starts_with("W/")) etag.remove_prefix(2);
+    return etag;
+}
+
+} // anon
+
+std::string make_etag(FileInfo const& info, ContentEncoding encoding)
+{
+    if (encoding == ContentEncoding::identity) {
+        return std::format("\"{:x}-{:x}-{:x}\"", info.inode, info.size, info.mtime_ns);
+    }
+    return std::format("\"{:x}-{:x}-{:x}-{}\"", info.inode, info.size, info.mtime_ns, to_string(encoding));
+}
+
+std::string format_http_date(std::chrono::sys_seconds time)
+{
+    using namespace std::chrono;
+
+    auto const days = floor<std::chrono::days>(time);
+    year_month_day const ymd{days};
+    hh_mm_ss const hms{time - days};
+    weekday const wd{days};
+
+    return std::format(
+        "{}, {:02} {} {:04} {:02}:{:02}:{:02} GMT",
+        weekday_names[wd.c_encoding()],
+        static_cast<unsigned>(ymd.day()),
+        month_names[static_cast<unsigned>(ymd.month()) - 1],
+        static_cast<int>(ymd.year()),
+        hms.hours().count(),
+        hms.minutes().count(),
+        hms.seconds().count()
+    );
+}
+
+std::optional<std::chrono::sys_seconds> parse_http_date(std::string_view str) noexcept
+{
+    using namespace std::chrono;
+
+    // "Sun, 06 Nov 1994 08:49:37 GMT"
+    //  0123456789012345678901234567890
+    str = trim_ows(str);
+    if (str.size() != 29) return std::nullopt;
+    if (str.substr(3, 2) != ", " || str[7] != ' ' || str[11] != ' ' || str[16] != ' ' ||
+        str[19] != ':' || str[22] != ':' || str.substr(25) != " GMT"
+    ) {
+        return std::nullopt;
+    }
+
+    auto const month_it = std::ranges::find(month_names, str.substr(8, 3));
+    if (month_it == month_names.end()) return std::nullopt;
+
+    auto const d = parse_digits(str.substr(5, 2));
+    auto const y = parse_digits(str.substr(12, 4));
+    auto const hh = parse_digits(str.substr(17, 2));
+    auto const mm = parse_digits(str.substr(20, 2));
+    auto const ss = parse_digits(str.substr(23, 2));
+    if (!d || !y || !hh || !mm || !ss) return std::nullopt;
+    if (*hh > 23 || *mm > 59 || *ss > 60) return std::nullopt;
+
+    year_month_day const ymd{
+        year{*y},
+        month{static_cast<unsigned>(month_it - month_names.begin()) + 1},
+        day{static_cast<unsigned>(*d)}
+    };
+    if (!ymd.ok()) return std::nullopt;
+
+    return sys_days{ymd} + hours{*hh} + minutes{*mm} + seconds{*ss};
+}
+
+bool etag_list_matches(std::string_view etag_list, std::string_view etag) noexcept
+{
+    etag_list = trim_ows(etag_list);
+    if (etag_list == "*") return true;
+
+    auto const target = opaque_tag(etag);
+
+    while (!etag_list.empty()) {
+        auto const comma = etag_list.find(',');
+        auto const candidate = trim_ows(etag_list.substr(0, comma));
+        etag_list.remove_prefix(comma == std::string_view::npos ? etag_list.size() : comma + 1);
+
+        if (opaque_tag(candidate) == target) return true;
+    }
+    return false;
+}
+
+}
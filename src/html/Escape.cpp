@@ -0,0 +1,158 @@
+﻿#include "pch.h"
+
+#include "vein/html/Escape.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+# include <immintrin.h>
+# define VEIN_ESCAPE_SSE2 1
+#endif
+
+#if VEIN_ESCAPE_SSE2 && (defined(__GNUC__) || defined(__clang__))
+// compiled regardless of -m flags, used only if the CPU has it
+# define VEIN_ESCAPE_AVX2 1
+#endif
+
+
+namespace vein::html {
+
+namespace {
+
+constexpr std::array<bool, 256> is_special_table = [] {
+    std::array<bool, 256> res{};
+    for (unsigned char const c : std::string_view{"&<>\"'"}) {
+        res[c] = true;
+    }
+    return res;
+}();
+
+constexpr std::string_view reference_of(char c) noexcept
+{
+    switch (c) {
+    case '&':  return "&amp;";
+    case '<':  return "&lt;";
+    case '>':  return "&gt;";
+    case '"':  return "&quot;";
+    case '\'': return "&#39;";
+    default:   return {};
+    }
+}
+
+std::size_t find_scalar(char const* data, std::size_t size, std::size_t i) noexcept
+{
+    for (; i < size; ++i) {
+        if (is_special_table[static_cast<unsigned char>(data[i])]) return i;
+    }
+    return size;
+}
+
+#if VEIN_ESCAPE_SSE2
+
+std::size_t find_sse2(char const* data, std::size_t size) noexcept
+{
+    auto const amp = _mm_set1_epi8('&');
+    auto const lt = _mm_set1_epi8('<');
+    auto const gt = _mm_set1_epi8('>');
+    auto const dquote = _mm_set1_epi8('"');
+    auto const squote = _mm_set1_epi8('\'');
+
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto const chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+        auto const hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, amp), _mm_cmpeq_epi8(chunk, lt)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, gt), _mm_cmpeq_epi8(chunk, dquote)), _mm_cmpeq_epi8(chunk, squote))
+        );
+        if (auto const mask = static_cast<unsigned>(_mm_movemask_epi8(hit)); mask != 0) {
+            return i + static_cast<std::size_t>(std::countr_zero(mask));
+        }
+    }
+    return find_scalar(data, size, i);
+}
+
+#endif
+
+#if VEIN_ESCAPE_AVX2
+
+__attribute__((target("avx2")))
+std::size_t find_avx2(char const* data, std::size_t size) noexcept
+{
+    auto const amp = _mm256_set1_epi8('&');
+    auto const lt = _mm256_set1_epi8('<');
+    auto const gt = _mm256_set1_epi8('>');
+    auto const dquote = _mm256_set1_epi8('"');
+    auto const squote = _mm256_set1_epi8('\'');
+
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        auto const chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+        auto const hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, amp), _mm256_cmpeq_epi8(chunk, lt)),
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, gt), _mm256_cmpeq_epi8(chunk, dquote)), _mm256_cmpeq_epi8(chunk, squote))
+        );
+        if (auto const mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(hit)); mask != 0) {
+            return i + static_cast<std::size_t>(std::countr_zero(mask));
+        }
+    }
+    return i + find_sse2(data + i, size - i);
+}
+
+#endif
+
+using find_fn = std::size_t (*)(char const*, std::size_t) noexcept;
+
+find_fn select_find() noexcept
+{
+#if VEIN_ESCAPE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return find_avx2;
+#endif
+#if VEIN_ESCAPE_SSE2
+    return find_sse2;
+#else
+    return [](char const* data, std::size_t size) noexcept { return find_scalar(data, size, 0); };
+#endif
+}
+
+} // anon
+
+std::size_t find_html_special(std::string_view str) noexcept
+{
+    // short strings (class names, most attribute values) are not worth a dispatch
+    if (str.size() < 16) {
+        return find_scalar(str.data(), str.size(), 0);
+    }
+    static find_fn const find_impl = select_find();
+    return find_impl(str.data(), str.size());
+}
+
+void escape_html(OutputBuffer& out, std::string_view str)
+{
+    auto pos = find_html_special(str);
+    while (pos != str.size()) {
+        out += str.substr(0, pos);
+        out += reference_of(str[pos]);
+        str.remove_prefix(pos + 1);
+
+        // specials come in clusters (markup quoted in text, quoted values);
+        // look at the next few bytes before dispatching another vector scan
+        auto const near = std::min<std::size_t>(str.size(), 16);
+        pos = find_scalar(str.data(), near, 0);
+        if (pos == near) pos += find_html_special(str.substr(near));
+    }
+    out += str;
+}
+
+std::string escape_html(std::string_view str)
+{
+    OutputBuffer out;
+    escape_html(out, str);
+    return std::string{out.view()};
+}
+
+}
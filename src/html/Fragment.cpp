@@ -0,0 +1,79 @@
+﻿#include "pch.h"
+
+#include "vein/html/Fragment.hpp"
+
+#include <functional>
+#include <unordered_map>
+
+
+namespace vein::html {
+
+namespace {
+
+struct StringHash
+{
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+struct KeyedFragments
+{
+    std::mutex mtx;
+    std::unordered_map<std::string, std::weak_ptr<Fragment>, StringHash, std::equal_to<>> fragments;
+};
+
+KeyedFragments& keyed_fragments()
+{
+    static KeyedFragments instance;
+    return instance;
+}
+
+} // anon
+
+std::shared_ptr<Fragment> Fragment::keyed(std::string_view key)
+{
+    auto& keyed = keyed_fragments();
+    std::lock_guard lock{keyed.mtx};
+
+    auto it = keyed.fragments.find(key);
+    if (it == keyed.fragments.end()) {
+        it = keyed.fragments.emplace(std::string{key}, std::weak_ptr<Fragment>{}).first;
+    }
+
+    auto fragment = it->second.lock();
+    if (!fragment) {
+        fragment = std::make_shared<Fragment>(std::string{key});
+        it->second = fragment;
+    }
+    return fragment;
+}
+
+void Fragment::invalidate(std::string_view key)
+{
+    std::shared_ptr<Fragment> fragment;
+    {
+        auto& keyed = keyed_fragments();
+        std::lock_guard lock{keyed.mtx};
+
+        auto const it = keyed.fragments.find(key);
+        if (it == keyed.fragments.end()) return;
+        fragment = it->second.lock();
+    }
+    if (fragment) fragment->invalidate();
+}
+
+void Fragment::store(std::shared_ptr<std::string const> bytes, std::uint64_t version)
+{
+    std::lock_guard lock{mtx_};
+    if (version != version_.load(std::memory_order_relaxed)) return;
+    bytes_.store(std::move(bytes), std::memory_order_release);
+}
+
+void Fragment::invalidate()
+{
+    std::lock_guard lock{mtx_};
+    version_.fetch_add(1, std::memory_order_acq_rel);
+    bytes_.store(nullptr, std::memory_order_release);
+}
+
+}
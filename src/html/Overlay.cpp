@@ -0,0 +1,83 @@
+﻿#include "pch.h"
+
+#include "vein/html/Overlay.hpp"
+#include "vein/html/Document.hpp"
+#include "vein/html/RenderPlan.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace vein::html {
+
+namespace {
+
+[[nodiscard]] bool is_addressable(Tag const& tag, Document const& doc) noexcept
+{
+    return &tag == doc.body_tag || is_dynamic_tag(tag, doc);
+}
+
+} // anon
+
+Tag* Overlay::find(Tag const& shared, std::size_t count) const noexcept
+{
+    auto const last = copies_.begin() + count;
+    auto const it = std::ranges::find(copies_.begin(), last, &shared, &std::pair<Tag const*, Tag*>::first);
+    return it == last ? nullptr : it->second;
+}
+
+Tag* Overlay::patch(Tag const& shared, Document const& doc)
+{
+    if (auto* copy = find(shared, copies_.size())) return copy;
+
+    auto const slot = doc.slot_of.find(&shared);
+    if (slot == doc.slot_of.end()) {
+        throw std::invalid_argument{"the tag is not a dynamic tag of this document"};
+    }
+
+    auto const& slot_tag = *doc.dynamic_tags[slot->second];
+    // owned before it is recorded, so that no entry outlives its tag
+    auto& copy = owned_.emplace_back(allocate_tag(arena_.resource(), slot_tag, arena_.resource()));
+    record(slot_tag, *copy, doc, 0);
+
+    return find(shared, copies_.size());
+}
+
+Tag* Overlay::patch_root(Tag const& shared_root, Document const& doc)
+{
+    if (root_) return root_;
+
+    auto const adopt_count = copies_.size();
+    auto* copy = owned_.emplace_back(allocate_tag(arena_.resource(), shared_root, arena_.resource())).get();
+    record(shared_root, *copy, doc, adopt_count);
+    root_ = copy;
+    return root_;
+}
+
+void Overlay::record(Tag const& shared, Tag& copy, Document const& doc, std::size_t adopt_count)
+{
+    if (is_addressable(shared, doc)) {
+        copies_.emplace_back(&shared, &copy);
+    }
+
+    // read-only access keeps the fragments attached
+    auto const& shared_contents = shared.contents();
+    auto const& copy_contents = std::as_const(copy).contents();
+
+    for (std::size_t i = 0; i < shared_contents.size(); ++i) {
+        auto const* shared_child = std::get_if<TagPtr>(&shared_contents[i]);
+        if (!shared_child) continue;
+
+        if (adopt_count > 0) {
+            // the outermost patched tags are the roots of earlier copies
+            if (auto* patched = find(**shared_child, adopt_count)) {
+                auto const owner = std::ranges::find_if(owned_, [&](TagPtr const& root) { return root.get() == patched; });
+                std::swap(std::get<TagPtr>(copy.contents()[i]), *owner);
+                continue;
+            }
+        }
+        record(**shared_child, *std::get<TagPtr>(copy_contents[i]), doc, adopt_count);
+    }
+}
+
+}
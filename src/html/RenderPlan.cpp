@@ -0,0 +1,152 @@
+﻿#include "pch.h"
+
+#include "vein/html/RenderPlan.hpp"
+#include "vein/html/Document.hpp"
+#include "vein/html/Escape.hpp"
+#include "vein/html/Overlay.hpp"
+
+#include <yk/util/overloaded.hpp>
+#include <yk/variant/std.hpp>
+
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+
+namespace vein::html {
+
+bool is_dynamic_tag(Tag const& tag, Document const& doc) noexcept
+{
+    return
+        &tag == doc.title_tag ||
+        &tag == doc.description_tag ||
+        &tag == doc.link_rel_canonical_tag ||
+        tag.attrs().contains("id") ||
+        tag.fragment() != nullptr;
+}
+
+namespace {
+
+void index_slot(Tag const& tag, Document& doc, std::size_t slot)
+{
+    if (is_dynamic_tag(tag, doc)) {
+        doc.slot_of.emplace(&tag, slot);
+    }
+    for (auto const& content : tag.contents()) {
+        if (auto const* child = std::get_if<TagPtr>(&content)) {
+            index_slot(**child, doc, slot);
+        }
+    }
+}
+
+[[nodiscard]] bool contains_fragment(Tag const& tag) noexcept
+{
+    if (tag.fragment()) return true;
+
+    for (auto const& content : tag.contents()) {
+        if (auto const* child = std::get_if<TagPtr>(&content); child && contains_fragment(**child)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // anon
+
+void index_dynamic_tags(Tag& root, Document& doc)
+{
+    if (is_dynamic_tag(root, doc)) {
+        doc.dynamic_tags.push_back(&root);
+        index_slot(root, doc, doc.dynamic_tags.size() - 1);
+        return;
+    }
+
+    // read-only access keeps the fragments attached
+    for (auto const& content : std::as_const(root).contents()) {
+        if (auto const* tag = std::get_if<TagPtr>(&content)) {
+            index_dynamic_tags(**tag, doc);
+        }
+    }
+}
+
+RenderPlan::RenderPlan(std::string_view prefix, Tag const& root, Document const& doc)
+{
+    OutputBuffer buf;
+    buf += prefix;
+    compile(root, doc, buf);
+    segments_.emplace_back(buf.view());
+
+    for (auto const& segment : segments_) {
+        static_size_ += segment.size();
+    }
+    for (auto const& bytes : defaults_) {
+        if (bytes) {
+            static_size_ += bytes->size();
+        } else {
+            preserialized_ = false;
+        }
+    }
+}
+
+void RenderPlan::compile(Tag const& tag, Document const& doc, OutputBuffer& buf)
+{
+    if (is_dynamic_tag(tag, doc)) {
+        // the slot sits between this segment and the next one
+        segments_.emplace_back(buf.view());
+        buf.clear();
+
+        // fragments may be invalidated at any time, so they are rendered
+        if (contains_fragment(tag)) {
+            defaults_.emplace_back();
+        } else {
+            defaults_.emplace_back(tag.str());
+        }
+        return;
+    }
+
+    if (tag.is_omitted()) return;
+
+    tag.write_start_tag(buf);
+
+    if (!tag.contents().empty() && tag.is_void_element()) {
+        throw std::invalid_argument{"void element cannot contain content"};
+    }
+
+    for (auto const& content : tag.contents()) {
+        yk::visit(yk::overloaded{
+            [&](std::string const& str) {
+                buf += str;
+            },
+            [&](Text const& text) {
+                escape_html(buf, text.value);
+            },
+            [&](StaticMarkup const& markup) {
+                buf += markup.bytes;
+            },
+            [&](TagPtr const& child) {
+                compile(*child, doc, buf);
+            },
+        }, content);
+    }
+
+    tag.write_end_tag(buf);
+}
+
+void RenderPlan::render(OutputBuffer& out, std::span<Tag* const> dynamic_tags, Overlay const& overlay) const
+{
+    assert(dynamic_tags.size() == slot_count());
+
+    for (std::size_t i = 0; i < dynamic_tags.size(); ++i) {
+        out += segments_[i];
+
+        auto const& tag = overlay.resolve(*dynamic_tags[i]);
+        if (&tag == dynamic_tags[i] && defaults_[i]) {
+            out += *defaults_[i];
+        } else {
+            tag.write_to(out);
+        }
+    }
+    out += segments_.back();
+}
+
+}
@@ -1,78 +1,108 @@
 #include "pch.h"
 
 #include "vein/html/Tag.hpp"
+#include "vein/html/Escape.hpp"
 
 #include <yk/util/overloaded.hpp>
 #include <yk/variant_view/boost.hpp>
 
-#include <regex>
-#include <algorithm>
-#include <ranges>
-#include <format>
+#include <stdexcept>
+#include <string_view>
 
 
 namespace vein::html {
 
-std::string Tag::str() const
+bool Tag::is_omitted() const noexcept
 {
     if (type_ == TagType::link && matches("rel", "canonical")) {
         auto const it = attrs_.find("href");
-        if (it == attrs_.end()) return {};
-        if (std::get<std::string>(it->second).empty()) return {};
+        if (it == attrs_.end()) return true;
+        if (std::get<std::string>(it->second).empty()) return true;
 
     } else if (type_ == TagType::meta && matches("name", "description")) {
         auto const it = attrs_.find("content");
-        if (it == attrs_.end()) return {};
-        if (std::get<std::string>(it->second).empty()) return {};
+        if (it == attrs_.end()) return true;
+        if (std::get<std::string>(it->second).empty()) return true;
+    }
+    return false;
+}
+
+void Tag::write_start_tag(OutputBuffer& out) const
+{
+    out += '<';
+    out += tag_name(type_);
+
+    for (auto const& [k, v] : attrs_) {
+        out += ' ';
+        out += k;
+
+        std::visit(yk::overloaded{
+            [](std::monostate const&) {
+            },
+            [&](int const& v) {
+                out += '=';
+                out.append_integer(v);
+            },
+            [&](std::string const& v) {
+                out += "=\"";
+                escape_html(out, v);
+                out += '"';
+            },
+            [&](ClassList const& classes) {
+                out += "=\"";
+                bool first = true;
+                for (auto const& str : classes) {
+                    if (!first) out += ' ';
+                    first = false;
+                    escape_html(out, str);
+                }
+                out += '"';
+            },
+        }, v);
+    }
+
+    out += '>';
+}
+
+void Tag::write_end_tag(OutputBuffer& out) const
+{
+    if (!is_void_element()) {
+        out += "</";
+        out += tag_name(type_);
+        out += '>';
+    }
+}
+
+void Tag::write_to(OutputBuffer& out) const
+{
+    if (!fragment_) {
+        return write_tree(out);
     }
 
-    auto const type_str = to_string(type_);
-
-    std::string res;
-
-    if (attrs_.empty()) {
-        res = std::format("<{}>", type_str);
-
-    } else {
-        static std::regex const quotes_rgx{R"(")"};
-
-        auto const attrs_str = attrs_ |
-            std::views::transform([](auto const& kv) {
-                auto const& [k, v] = kv;
-
-                std::string res = k;
-
-                std::visit(yk::overloaded{
-                    [](std::monostate const&) {
-                    },
-                    [&](int const& v) {
-                        res += '=';
-                        res += std::to_string(v);
-                    },
-                    [&](std::string const& v) {
-                        res += "=\"";
-                        res += std::regex_replace(v, quotes_rgx, "&quot;");
-                        res += '"';
-                    },
-                    [&](ClassList const& classes) {
-                        res += "=\"";
-                        res += classes
-                            | std::views::transform([&](auto const& str) {
-                                return std::regex_replace(str, quotes_rgx, "&quot;");
-                            })
-                            | std::views::join_with(std::string_view{" "})
-                            | std::ranges::to<std::string>();
-                        res += '"';
-                    },
-                }, v);
-                return res;
-            })
-            | std::views::join_with(' ')
-            | std::ranges::to<std::string>();
-
-        res = std::format("<{} {}>", type_str, attrs_str);
+    if (auto const bytes = fragment_->bytes()) {
+        out += *bytes;
+        return;
     }
 
+    // a copy may hold one request's changes, which must not be shared
+    if (fragment_borrowed_) {
+        return write_tree(out);
+    }
+
+    // concurrent first renders all produce the same bytes; any of them may win
+    auto const version = fragment_->version();
+    OutputBuffer buf;
+    write_tree(buf);
+    out += buf.view();
+    fragment_->store(std::make_shared<std::string const>(buf.view()), version);
+}
+
+void Tag::write_tree(OutputBuffer& out) const
+{
+    if (is_omitted()) return;
+
+    write_start_tag(out);
+
     if (!contents_.empty()) {
         if (is_void_element()) {
             throw std::invalid_argument{"void element cannot contain content"};
@@ -81,20 +111,29 @@ std::string Tag::str() const
         for (auto const& content : contents_) {
             yk::visit(yk::overloaded{
                 [&](std::string const& str) {
-                    res += str;
+                    out += str;
+                },
+                [&](Text const& text) {
+                    escape_html(out, text.value);
+                },
+                [&](StaticMarkup const& markup) {
+                    out += markup.bytes;
                 },
                 [&](TagPtr const& tag) {
-                    res += tag->str();
+                    tag->write_to(out);
                 },
             }, content);
         }
     }
 
-    if (!is_void_element()) {
-        res += std::format("</{}>", type_str);
-    }
+    write_end_tag(out);
+}
 
-    return res;
+std::string Tag::str() const
+{
+    OutputBuffer out;
+    write_to(out);
+    return std::string{out.view()};
 }
 
 }
@@ -1,13 +1,129 @@
 ﻿#include "pch.h"
 
 #include "vein/html/Template.hpp"
+#include "vein/html/Escape.hpp"
+#include "vein/FileWatcher.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <fstream>
+#include <iostream>
+#include <stdexcept>
 
 
 namespace vein::html {
 
-std::string const& TemplateLoader::partial(std::string const& rel_path)
+namespace {
+
+[[nodiscard]] std::string_view trim(std::string_view str) noexcept
+{
+    auto const first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) return {};
+    auto const last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+
+// `path` is `dir` or somewhere under it
+[[nodiscard]] bool is_within(std::filesystem::path const& path, std::filesystem::path const& dir)
+{
+    auto const [dir_end, _] = std::mismatch(dir.begin(), dir.end(), path.begin(), path.end());
+    return dir_end == dir.end();
+}
+
+} // anon
+
+Template Template::parse(std::string_view source)
+{
+    Template tpl;
+    std::string_view rest = source;
+
+    while (true) {
+        auto const open = rest.find("{{");
+        if (open == std::string_view::npos) break;
+
+        auto const close = rest.find("}}", open + 2);
+        if (close == std::string_view::npos) {
+            throw std::invalid_argument{"unterminated template slot at offset " + std::to_string(source.size() - rest.size() + open)};
+        }
+
+        tpl.segments_.emplace_back(rest.substr(0, open));
+
+        auto name = trim(rest.substr(open + 2, close - open - 2));
+        bool const raw = name.starts_with('&');
+        if (raw) name = trim(name.substr(1));
+        if (name.empty()) {
+            throw std::invalid_argument{"empty template slot at offset " + std::to_string(source.size() - rest.size() + open)};
+        }
+
+        auto index = tpl.find(name);
+        if (!index) {
+            index = tpl.names_.size();
+            tpl.names_.emplace_back(name);
+        }
+        tpl.slots_.push_back(Slot{*index, raw});
+
+        rest.remove_prefix(close + 2);
+    }
+    tpl.segments_.emplace_back(rest);
+
+    for (auto const& segment : tpl.segments_) {
+        tpl.static_size_ += segment.size();
+    }
+    return tpl;
+}
+
+std::optional<std::size_t> Template::find(std::string_view name) const noexcept
+{
+    auto const it = std::ranges::find(names_, name);
+    if (it == names_.end()) return std::nullopt;
+    return static_cast<std::size_t>(it - names_.begin());
+}
+
+void Template::render(OutputBuffer& out, std::span<std::string_view const> values) const
+{
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        out += segments_[i];
+
+        auto const& slot = slots_[i];
+        if (slot.name >= values.size()) continue;
+
+        if (slot.raw) {
+            out += values[slot.name];
+        } else {
+            escape_html(out, values[slot.name]);
+        }
+    }
+    out += segments_.back();
+}
+
+TemplateLoader::TemplateLoader(std::filesystem::path const& root)
+    : root_(canonical(root))
+    , snapshot_(std::make_shared<Snapshot const>())
+{
+    watcher_ = std::make_unique<FileWatcher>(root_, [this](std::filesystem::path const& changed) {
+        reload(changed);
+    });
+}
+
+TemplateLoader::~TemplateLoader() = default;
+
+std::shared_ptr<Template const> TemplateLoader::load(std::filesystem::path const& path)
+{
+    std::ifstream ifs{path, std::ios::in | std::ios::binary};
+    if (!ifs) {
+        throw std::invalid_argument{"template does not exist on filesystem: " + path.string()};
+    }
+
+    std::string buf{std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+
+    try {
+        return std::make_shared<Template const>(Template::parse(buf));
+    } catch (std::invalid_argument const& e) {
+        throw std::invalid_argument{path.string() + ": " + e.what()};
+    }
+}
+
+TemplateLoader::Handle TemplateLoader::partial_handle(std::string const& rel_path)
 {
     auto path = std::filesystem::path(rel_path);
 
@@ -15,30 +131,60 @@ std::string const& TemplateLoader::partial(std::string const& rel_path)
         throw std::invalid_argument{"partial template file name does not start with underscore"};
     }
     path.replace_extension("html");
-    path = canonical(root_ / path);
-
-    if (auto const it = partial_cache_.find(path); it != partial_cache_.end()) {
-        return it->second;
+    path = weakly_canonical(root_ / path);
+    if (!is_within(path, root_)) {
+        throw std::invalid_argument{"partial template is outside of the template root: " + path.string()};
     }
-    if (!exists(path)) {
-        throw std::invalid_argument{"partial template does not exist on filesystem: " + path.string()};
+
+    std::lock_guard lock{mtx_};
+
+    if (auto const it = std::ranges::find(paths_, path); it != paths_.end()) {
+        return Handle{this, static_cast<std::size_t>(it - paths_.begin())};
     }
 
+    auto tpl = load(path);
+
+    auto next = std::make_shared<Snapshot>(*snapshot_.load(std::memory_order_acquire));
+    next->templates.push_back(std::move(tpl));
+    paths_.push_back(std::move(path));
+    snapshot_.store(std::move(next), std::memory_order_release);
+
+    return Handle{this, paths_.size() - 1};
+}
 
-    std::string buf;
-    buf.resize(file_size(path));
+std::shared_ptr<Template const> TemplateLoader::get(Handle handle) const
+{
+    assert(handle.loader_ == this);
+
+    auto const snapshot = snapshot_.load(std::memory_order_acquire);
+    assert(handle.index_ < snapshot->templates.size());
+    return snapshot->templates[handle.index_];
+}
 
-    {
-        std::ifstream ifs{path, std::ios::in | std::ios::binary};
-        ifs.read(buf.data(), buf.size());
+void TemplateLoader::reload(std::filesystem::path const& changed)
+{
+    std::lock_guard lock{mtx_};
+
+    std::shared_ptr<Snapshot> next;
+
+    for (std::size_t i = 0; i < paths_.size(); ++i) {
+        if (!is_within(paths_[i], changed)) continue;
+
+        if (!next) {
+            next = std::make_shared<Snapshot>(*snapshot_.load(std::memory_order_acquire));
+        }
+
+        // a file being replaced may be briefly missing; keep serving the old version
+        try {
+            next->templates[i] = load(paths_[i]);
+        } catch (std::exception const& e) {
+            std::cerr << "warning: failed to reload template: " << e.what() << std::endl;
+        }
     }
 
-    auto [kv, _] = partial_cache_.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(path),
-        std::forward_as_tuple(std::move(buf))
-    );
-    return kv->second;
+    if (next) {
+        snapshot_.store(std::move(next), std::memory_order_release);
+    }
 }
 
 }
@@ -0,0 +1,154 @@
+﻿#include "vein/html/Escape.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+
+
+namespace {
+
+using namespace vein;
+
+constexpr std::string_view specials = "&<>\"'";
+
+// What escape_html() must produce, one character at a time
+std::string reference_escape(std::string_view str)
+{
+    std::string res;
+    for (char const c : str) {
+        switch (c) {
+        case '&':  res += "&amp;"; break;
+        case '<':  res += "&lt;"; break;
+        case '>':  res += "&gt;"; break;
+        case '"':  res += "&quot;"; break;
+        case '\'': res += "&#39;"; break;
+        default:   res += c; break;
+        }
+    }
+    return res;
+}
+
+std::size_t reference_find(std::string_view str)
+{
+    auto const pos = str.find_first_of(specials);
+    return pos == std::string_view::npos ? str.size() : pos;
+}
+
+// Compares both overloads and find_html_special() with the reference
+void check(std::string_view str)
+{
+    auto const expected = reference_escape(str);
+    BOOST_TEST_EQ(html::escape_html(str), expected);
+
+    // appended after what the buffer already holds
+    html::OutputBuffer out;
+    out.append("prefix");
+    html::escape_html(out, str);
+    BOOST_TEST_EQ(out.view(), "prefix" + expected);
+
+    BOOST_TEST_EQ(html::find_html_special(str), reference_find(str));
+}
+
+void test_references()
+{
+    BOOST_TEST_EQ(html::escape_html("&"), "&amp;");
+    BOOST_TEST_EQ(html::escape_html("<"), "&lt;");
+    BOOST_TEST_EQ(html::escape_html(">"), "&gt;");
+    BOOST_TEST_EQ(html::escape_html("\""), "&quot;");
+    BOOST_TEST_EQ(html::escape_html("'"), "&#39;");
+    BOOST_TEST_EQ(html::escape_html("a<b>&amp;</b>"), "a&lt;b&gt;&amp;amp;&lt;/b&gt;");
+}
+
+void test_short_inputs()
+{
+    check("");
+    for (std::size_t size = 1; size < 16; ++size) {
+        std::string const plain(size, 'a');
+        check(plain);
+
+        for (std::size_t pos = 0; pos < size; ++pos) {
+            for (char const c : specials) {
+                auto str = plain;
+                str[pos] = c;
+                check(str);
+            }
+        }
+    }
+}
+
+// A special at each offset around the 16- and 32-byte blocks and in the
+// tail left after them, in inputs of every length up to 100
+void test_offsets()
+{
+    for (std::size_t size = 1; size <= 100; ++size) {
+        std::string const plain(size, 'x');
+
+        for (std::size_t const pos : {0, 1, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 95, 96, 99}) {
+            if (pos >= size) continue;
+
+            for (char const c : specials) {
+                auto str = plain;
+                str[pos] = c;
+                check(str);
+
+                // and the last byte, for the tail
+                str.back() = c;
+                check(str);
+            }
+        }
+
+        // every byte special
+        for (char const c : specials) {
+            check(std::string(size, c));
+        }
+    }
+}
+
+void test_utf8()
+{
+    check("日本語のテキスト");
+    check("日本語の<テキスト>と\"引用\"と'&'");
+    check("\xC3\xA9\xC3\xA8<\xE2\x82\xAC>\xF0\x9F\x98\x80&\xF0\x9F\x98\x80\xF0\x9F\x98\x80\xF0\x9F\x98\x80\xF0\x9F\x98\x80\xF0\x9F\x98\x80'");
+
+    // bytes with the high bit set are never taken for specials
+    std::string high;
+    for (int c = 0x80; c <= 0xFF; ++c) high += static_cast<char>(c);
+    check(high);
+}
+
+void test_random()
+{
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<std::size_t> size_dist{0, 300};
+    std::uniform_int_distribution<int> byte_dist{0, 255};
+    std::uniform_int_distribution<int> density_dist{0, 4};
+
+    for (int i = 0; i < 2000; ++i) {
+        std::string str(size_dist(rng), '\0');
+
+        // from no specials to mostly specials
+        auto const density = density_dist(rng);
+        std::uniform_int_distribution<int> special_dist{0, 15};
+        for (auto& c : str) {
+            c = special_dist(rng) < density * 4
+                ? specials[static_cast<std::size_t>(byte_dist(rng)) % specials.size()]
+                : static_cast<char>(byte_dist(rng));
+        }
+        check(str);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    test_references();
+    test_short_inputs();
+    test_offsets();
+    test_utf8();
+    test_random();
+    return boost::report_errors();
+}
@@ -0,0 +1,170 @@
+﻿#include "vein/Form.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+using namespace vein;
+
+bool parse_throws(std::string_view content_type, std::string_view body)
+{
+    try {
+        (void)Form::parse(content_type, body);
+    } catch (std::invalid_argument const&) {
+        return true;
+    }
+    return false;
+}
+
+void test_decode_form_component()
+{
+    BOOST_TEST_EQ(decode_form_component(""), "");
+    BOOST_TEST_EQ(decode_form_component("abc"), "abc");
+    BOOST_TEST_EQ(decode_form_component("a+b%20c"), "a b c");
+    BOOST_TEST_EQ(decode_form_component("J%C3%B6rg"), "J\xC3\xB6rg");
+    BOOST_TEST_EQ(decode_form_component("%2b%2B"), "++");
+
+    // malformed escapes are kept as they are
+    BOOST_TEST_EQ(decode_form_component("%"), "%");
+    BOOST_TEST_EQ(decode_form_component("%4"), "%4");
+    BOOST_TEST_EQ(decode_form_component("%zz%41"), "%zzA");
+    BOOST_TEST_EQ(decode_form_component("100%"), "100%");
+}
+
+void test_urlencoded()
+{
+    auto const form = Form::parse("application/x-www-form-urlencoded", "a=1&first+name=J%C3%B6rg&flag&&=empty&a=2&eq=1=2&");
+
+    BOOST_TEST_EQ(form.fields().size(), 6u);
+
+    // the first of duplicates
+    BOOST_TEST(form.get("a") == std::optional<std::string>{"1"});
+
+    // names and values are decoded on access
+    BOOST_TEST(form.get("first name") == std::optional<std::string>{"J\xC3\xB6rg"});
+    BOOST_TEST_EQ(form.find("first name")->name, "first+name");
+    BOOST_TEST_EQ(form.find("first name")->decoded_name(), "first name");
+    BOOST_TEST(!form.find("first+name"));
+
+    BOOST_TEST(form.get("flag") == std::optional<std::string>{""});
+    BOOST_TEST(form.get("") == std::optional<std::string>{"empty"});
+    BOOST_TEST(form.get("eq") == std::optional<std::string>{"1=2"});
+    BOOST_TEST(!form.get("missing"));
+
+    BOOST_TEST(Form::parse_urlencoded("").empty());
+    BOOST_TEST(Form::parse_urlencoded("&&").empty());
+}
+
+void test_content_type()
+{
+    BOOST_TEST(Form::parse("Application/X-WWW-Form-Urlencoded; charset=utf-8", "a=1").get("a"));
+    BOOST_TEST(Form::parse("text/plain", "a=1").empty());
+    BOOST_TEST(Form::parse("", "a=1").empty());
+
+    BOOST_TEST(parse_throws("multipart/form-data", "--B\r\n\r\n--B--"));
+    BOOST_TEST(parse_throws("multipart/form-data; boundary=", "--B\r\n\r\n--B--"));
+    BOOST_TEST(parse_throws("multipart/form-data; boundary=\"B", "--B\r\n\r\n--B--"));
+}
+
+void test_multipart()
+{
+    std::string_view const body =
+        "preamble\r\n"
+        "--AaB03x\r\n"
+        "Content-Disposition: form-data; name=\"submit-name\"\r\n"
+        "\r\n"
+        "Larry+%41\r\n"
+        "--AaB03x  \r\n"
+        "content-disposition: form-data; name=\"files\"; filename=\"file1.txt\"\r\n"
+        "Content-Type: text/plain\r\n"
+        "\r\n"
+        "line 1\r\n"
+        "--AaB03 is not the boundary\r\n"
+        "\r\n"
+        "--AaB03x\r\n"
+        "Content-Disposition: form-data; name=empty\r\n"
+        "\r\n"
+        "\r\n"
+        "--AaB03x--\r\n"
+        "epilogue";
+
+    auto const form = Form::parse("multipart/form-data; boundary=\"AaB03x\"", body);
+    BOOST_TEST_EQ(form.fields().size(), 3u);
+
+    // multipart values are not urlencoded
+    auto const* name = form.find("submit-name");
+    BOOST_TEST(name);
+    BOOST_TEST_EQ(name->value, "Larry+%41");
+    BOOST_TEST(form.get("submit-name") == std::optional<std::string>{"Larry+%41"});
+    BOOST_TEST(name->filename.empty());
+    BOOST_TEST(name->content_type.empty());
+
+    auto const* file = form.find("files");
+    BOOST_TEST(file);
+    BOOST_TEST_EQ(file->value, "line 1\r\n--AaB03 is not the boundary\r\n");
+    BOOST_TEST_EQ(file->filename, "file1.txt");
+    BOOST_TEST_EQ(file->content_type, "text/plain");
+
+    // views of the body
+    BOOST_TEST(file->value.data() >= body.data() && file->value.data() < body.data() + body.size());
+
+    auto const* empty = form.find("empty");
+    BOOST_TEST(empty);
+    BOOST_TEST(empty->value.empty());
+
+    // no parts at all
+    BOOST_TEST(Form::parse_multipart("B", "--B--").empty());
+    BOOST_TEST(Form::parse_multipart("B", "--B--\r\n").empty());
+}
+
+void test_malformed_multipart()
+{
+    auto const throws = [](std::string_view body) {
+        try {
+            (void)Form::parse_multipart("B", body);
+        } catch (std::invalid_argument const&) {
+            return true;
+        }
+        return false;
+    };
+
+    auto const part = "Content-Disposition: form-data; name=\"a\"\r\n\r\nvalue";
+
+    BOOST_TEST(!throws(std::string{"--B\r\n"} + part + "\r\n--B--"));
+
+    BOOST_TEST(throws(""));
+    BOOST_TEST(throws("no boundary here"));
+    BOOST_TEST(throws("--Bx\r\n"));
+
+    // no close delimiter
+    BOOST_TEST(throws(std::string{"--B\r\n"} + part));
+    BOOST_TEST(throws(std::string{"--B\r\n"} + part + "\r\n--B"));
+    BOOST_TEST(throws(std::string{"--B\r\n"} + part + "\r\n--B\r\n"));
+
+    // headers without an empty line
+    BOOST_TEST(throws("--B\r\nContent-Disposition: form-data; name=\"a\"\r\n--B--"));
+
+    // parts without a name
+    BOOST_TEST(throws("--B\r\n\r\nvalue\r\n--B--"));
+    BOOST_TEST(throws("--B\r\nContent-Type: text/plain\r\n\r\nvalue\r\n--B--"));
+    BOOST_TEST(throws("--B\r\nContent-Disposition: form-data; name=\"a\r\n\r\nvalue\r\n--B--"));
+
+    // text after the boundary on its line
+    BOOST_TEST(throws(std::string{"--B x\r\n"} + part + "\r\n--B--"));
+}
+
+} // anon
+
+int main()
+{
+    test_decode_form_component();
+    test_urlencoded();
+    test_content_type();
+    test_multipart();
+    test_malformed_multipart();
+    return boost::report_errors();
+}
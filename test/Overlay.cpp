@@ -0,0 +1,220 @@
+﻿#include "vein/Controller.hpp"
+#include "vein/html/Document.hpp"
+#include "vein/html/Fragment.hpp"
+#include "vein/html/Overlay.hpp"
+#include "vein/html/RenderPlan.hpp"
+
+#include <boost/beast/core/buffers_to_string.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include <boost/url/parse.hpp>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+
+namespace {
+
+using namespace vein;
+using html::Tag;
+using html::TagPtr;
+using html::TagType;
+
+TagPtr make_tag(TagType type, char const* id = nullptr)
+{
+    auto tag = html::allocate_tag(std::pmr::get_default_resource(), type);
+    if (id) tag->attrs().emplace("id", id);
+    return tag;
+}
+
+Tag& append(Tag& parent, TagPtr child)
+{
+    auto& res = *child;
+    parent.contents().emplace_back(std::move(child));
+    return res;
+}
+
+// <title>, #main and <body> are patched by "/patch" and left alone by "/"
+class PatchingController : public CustomController<PatchingController>
+{
+public:
+    PatchingController()
+    {
+        auto html = std::make_unique<Tag>(TagType::html);
+        auto& head = append(*html, make_tag(TagType::head));
+        append(head, make_tag(TagType::title)).append_string_content("Default");
+        auto& body = append(*html, make_tag(TagType::body));
+        append(body, make_tag(TagType::div, "main")).append_text_content("main");
+        append(body, make_tag(TagType::p)).append_text_content("static");
+        this->set_html(std::move(html));
+
+        this->set_default_callback([this](boost::urls::url_view const& url, HTTPFields&) {
+            if (url.path() == "/patch") {
+                this->set_title("Patched");
+
+                auto* main = this->tag_by_id("main");
+                main->contents().clear();
+                main->append_text_content("<changed>");
+
+                this->body_tag()->append_string_content("<hr>");
+            }
+            return http::status::ok;
+        });
+    }
+};
+
+// The body of the response `controller` renders for a GET of `target`
+std::string get(PatchingController const& controller, char const* target)
+{
+    http::request<http::string_body> req{http::verb::get, target, 11};
+    req.set(http::field::host, "localhost");
+
+    auto res = controller.on_request(req, *boost::urls::parse_origin_form(target));
+    auto* gen = res.generator();
+    if (!gen) {
+        BOOST_ERROR("not a rendered response");
+        return {};
+    }
+
+    std::string message;
+    beast::error_code ec;
+    while (!gen->is_done()) {
+        auto const buffers = gen->prepare(ec);
+        if (ec) {
+            BOOST_ERROR(ec.message().c_str());
+            return {};
+        }
+        message += beast::buffers_to_string(buffers);
+        gen->consume(beast::buffer_bytes(buffers));
+    }
+    return message.substr(message.find("\r\n\r\n") + 4);
+}
+
+void test_requests_are_isolated()
+{
+    PatchingController const controller;
+
+    auto const plain = get(controller, "/");
+    BOOST_TEST(plain.contains("<title>Default</title>"));
+    BOOST_TEST(plain.contains(">main</div>"));
+    BOOST_TEST(!plain.contains("<hr>"));
+
+    auto const patched = get(controller, "/patch");
+    BOOST_TEST(patched.contains("<title>Patched</title>"));
+    BOOST_TEST(patched.contains(">&lt;changed&gt;</div>"));
+    BOOST_TEST(patched.contains("<hr>"));
+
+    // the same thread, and so the same overlay, serves the next request
+    BOOST_TEST_EQ(get(controller, "/"), plain);
+
+    BOOST_TEST_EQ(get(controller, "/patch"), patched);
+    BOOST_TEST_EQ(get(controller, "/"), plain);
+}
+
+// html > (head > title), (body > #outer > #inner)
+struct Page
+{
+    TagPtr root = make_tag(TagType::html);
+    html::Document doc;
+    Tag* outer = nullptr;
+    Tag* inner = nullptr;
+
+    Page()
+    {
+        auto& head = append(*root, make_tag(TagType::head));
+        doc.head_tag = &head;
+        doc.title_tag = &append(head, make_tag(TagType::title));
+        doc.title_tag->append_string_content("T");
+
+        doc.body_tag = &append(*root, make_tag(TagType::body));
+        outer = &append(*doc.body_tag, make_tag(TagType::div, "outer"));
+        inner = &append(*outer, make_tag(TagType::span, "inner"));
+        inner->append_text_content("in");
+
+        html::index_dynamic_tags(*root, doc);
+    }
+};
+
+void test_patch_root_adopts_patched_slots()
+{
+    Page page;
+    html::RenderPlan const plan{"", *page.root, page.doc};
+    auto const original = page.root->str();
+
+    html::Overlay overlay{64};
+    for (int i = 0; i < 2; ++i) {
+        html::Overlay::Scope scope{overlay};
+
+        auto* inner = overlay.patch(*page.inner, page.doc);
+        inner->contents().clear();
+        inner->append_text_content("patched");
+
+        auto const* root = overlay.patch_root(*page.root, page.doc);
+        BOOST_TEST_EQ(overlay.root(), root);
+
+        // the earlier copy is part of the new tree, not replaced by a fresh one
+        BOOST_TEST_EQ(overlay.patch(*page.inner, page.doc), inner);
+        BOOST_TEST(root->str().contains(">patched</span>"));
+
+        overlay.patch(*page.doc.body_tag, page.doc)->append_string_content("<hr>");
+        auto const rendered = root->str();
+        BOOST_TEST(rendered.contains(">patched</span>"));
+        BOOST_TEST(rendered.contains("<hr>"));
+    }
+
+    BOOST_TEST(!overlay.root());
+    BOOST_TEST_EQ(page.root->str(), original);
+
+    html::OutputBuffer out;
+    plan.render(out, page.doc.dynamic_tags, overlay);
+    BOOST_TEST_EQ(out.view(), original);
+}
+
+void test_borrowed_fragment_is_not_published()
+{
+    // body > div (cached) > span
+    auto root = make_tag(TagType::html);
+    html::Document doc;
+    doc.head_tag = &append(*root, make_tag(TagType::head));
+    doc.body_tag = &append(*root, make_tag(TagType::body));
+    auto& cached = append(*doc.body_tag, make_tag(TagType::div));
+    append(cached, make_tag(TagType::span)).append_text_content("shared");
+
+    auto const fragment = std::make_shared<html::Fragment>();
+    cached.set_fragment(fragment);
+
+    html::index_dynamic_tags(*root, doc);
+    html::RenderPlan const plan{"", *root, doc};
+
+    html::Overlay overlay{64};
+    {
+        html::Overlay::Scope scope{overlay};
+
+        // the fragment is still empty, so the copy renders first
+        overlay.patch_root(*root, doc);
+        auto* copy = overlay.patch(cached, doc);
+        auto& span = *std::get<TagPtr>(std::as_const(*copy).contents()[0]);
+        span.contents().clear();
+        span.append_text_content("private");
+
+        html::OutputBuffer out;
+        overlay.root()->write_to(out);
+        BOOST_TEST(out.view().contains("private"));
+    }
+    BOOST_TEST(!fragment->bytes());
+
+    html::OutputBuffer out;
+    plan.render(out, doc.dynamic_tags, overlay);
+    BOOST_TEST(out.view().contains("shared"));
+    BOOST_TEST(fragment->bytes() && !fragment->bytes()->contains("private"));
+}
+
+} // namespace
+
+int main()
+{
+    test_requests_are_isolated();
+    test_patch_root_adopts_patched_slots();
+    test_borrowed_fragment_is_not_published();
+    return boost::report_errors();
+}
@@ -0,0 +1,160 @@
+﻿#include "vein/Range.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+
+namespace {
+
+using namespace vein;
+
+constexpr std::uint64_t file_size = 10000;
+
+// Whether `field_value` gives exactly the `expected` ranges
+bool parses_to(std::string_view field_value, std::initializer_list<std::pair<std::uint64_t, std::uint64_t>> expected, std::uint64_t size = file_size)
+{
+    auto const ranges = parse_byte_ranges(field_value, size);
+    if (!ranges || ranges->size() != expected.size()) return false;
+
+    auto it = ranges->begin();
+    for (auto const& [first, last] : expected) {
+        if (it->first != first || it->last != last) return false;
+        ++it;
+    }
+    return true;
+}
+
+void test_single_ranges()
+{
+    BOOST_TEST(parses_to("bytes=0-499", {{0, 499}}));
+    BOOST_TEST(parses_to("bytes=500-", {{500, 9999}}));
+    BOOST_TEST(parses_to("bytes=9500-20000", {{9500, 9999}}));
+    BOOST_TEST(parses_to("bytes=0-0", {{0, 0}}));
+    BOOST_TEST(parses_to(" BYTES = 0-499 ", {{0, 499}}));
+}
+
+void test_suffix_ranges()
+{
+    BOOST_TEST(parses_to("bytes=-500", {{9500, 9999}}));
+    BOOST_TEST(parses_to("bytes=-1", {{9999, 9999}}));
+
+    // longer than the representation: the whole of it
+    BOOST_TEST(parses_to("bytes=-20000", {{0, 9999}}));
+}
+
+void test_overlapping_ranges()
+{
+    BOOST_TEST(parses_to("bytes=0-99,50-149", {{0, 149}}));
+    BOOST_TEST(parses_to("bytes=0-999,100-199", {{0, 999}}));
+    BOOST_TEST(parses_to("bytes=9000-,-500", {{9000, 9999}}));
+
+    // adjacent ranges are coalesced too
+    BOOST_TEST(parses_to("bytes=0-99,100-199", {{0, 199}}));
+
+    // sorted by position
+    BOOST_TEST(parses_to("bytes=500-599,0-99", {{0, 99}, {500, 599}}));
+    BOOST_TEST(parses_to("bytes=0-9, 20-29 ,\t40-49", {{0, 9}, {20, 29}, {40, 49}}));
+
+    // empty list elements are allowed
+    BOOST_TEST(parses_to("bytes=0-9,,20-29,", {{0, 9}, {20, 29}}));
+}
+
+void test_unsatisfiable_ranges()
+{
+    BOOST_TEST(parses_to("bytes=10000-", {}));
+    BOOST_TEST(parses_to("bytes=10000-10100", {}));
+    BOOST_TEST(parses_to("bytes=-0", {}));
+    BOOST_TEST(parses_to("bytes=-500", {}, 0));
+    BOOST_TEST(parses_to("bytes=0-", {}, 0));
+
+    // the satisfiable ones are served
+    BOOST_TEST(parses_to("bytes=20000-20100,0-0", {{0, 0}}));
+}
+
+void test_malformed_ranges()
+{
+    for (std::string_view const field_value : {
+        "",
+        "bytes",
+        "bytes=",
+        "bytes=,",
+        "items=0-499",
+        "bytes=abc",
+        "bytes=1",
+        "bytes=-",
+        "bytes=5-1",
+        "bytes=0-1-2",
+        "bytes=+0-1",
+        "bytes=0-499,x",
+        "bytes=99999999999999999999-",
+        "bytes=--5",
+    }) {
+        BOOST_TEST(!parse_byte_ranges(field_value, file_size));
+    }
+
+    // too many ranges are not worth honoring
+    std::string many = "bytes=0-0";
+    for (std::size_t i = 1; i < max_byte_ranges; ++i) {
+        many += ',' + std::to_string(i * 2) + '-' + std::to_string(i * 2);
+    }
+    BOOST_TEST(parse_byte_ranges(many, file_size));
+    many += ",100-100";
+    BOOST_TEST(!parse_byte_ranges(many, file_size));
+}
+
+void test_content_range()
+{
+    BOOST_TEST_EQ(content_range({0, 499}, 1234), "bytes 0-499/1234");
+    BOOST_TEST_EQ(content_range({1233, 1233}, 1234), "bytes 1233-1233/1234");
+}
+
+void test_set_byteranges()
+{
+    auto const path = std::filesystem::temp_directory_path() / "vein_test_range";
+    std::ofstream{path, std::ios::binary} << std::string(file_size, 'x');
+
+    FileBody::value_type body;
+    beast::error_code ec;
+    body.open(path.string().c_str(), ec);
+    BOOST_TEST(!ec);
+
+    ByteRange const ranges[] = {{0, 99}, {500, 599}};
+    auto const content_type = set_byteranges(body, ranges, "text/plain");
+
+    std::string_view const prefix = "multipart/byteranges; boundary=";
+    BOOST_TEST(content_type.starts_with(prefix));
+    auto const boundary = std::string_view{content_type}.substr(prefix.size());
+
+    BOOST_TEST_EQ(body.segments().size(), 2u);
+    BOOST_TEST_EQ(body.segments()[0].offset, 0u);
+    BOOST_TEST_EQ(body.segments()[0].size, 100u);
+    BOOST_TEST_EQ(body.segments()[1].offset, 500u);
+    BOOST_TEST_EQ(body.segments()[1].size, 100u);
+
+    BOOST_TEST(body.segments()[0].head.starts_with("--" + std::string{boundary} + "\r\n"));
+    BOOST_TEST(body.segments()[0].head.find("Content-Range: bytes 0-99/10000\r\n") != std::string::npos);
+    BOOST_TEST(body.segments()[1].head.starts_with("\r\n--" + std::string{boundary} + "\r\n"));
+    BOOST_TEST(body.segments()[1].head.find("Content-Range: bytes 500-599/10000\r\n") != std::string::npos);
+    BOOST_TEST_EQ(body.tail(), "\r\n--" + std::string{boundary} + "--\r\n");
+
+    std::filesystem::remove(path);
+}
+
+} // anon
+
+int main()
+{
+    test_single_ranges();
+    test_suffix_ranges();
+    test_overlapping_ranges();
+    test_unsatisfiable_ranges();
+    test_malformed_ranges();
+    test_content_range();
+    test_set_byteranges();
+    return boost::report_errors();
+}
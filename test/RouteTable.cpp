@@ -0,0 +1,187 @@
+﻿#include "vein/RouteTable.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+using namespace vein;
+
+// The value routed for `path`, or -1
+int route_of(RouteTable<int> const& table, std::string_view path)
+{
+    auto const m = table.match(path);
+    return m ? *m.value : -1;
+}
+
+void test_literal_routes()
+{
+    RouteTable<int> table;
+    table.insert("/", 0);
+    table.insert("/abc", 1);
+    table.insert("/abd", 2);
+    table.insert("/ab", 3);
+    table.insert("/abc/def", 4);
+
+    BOOST_TEST_EQ(route_of(table, "/"), 0);
+    BOOST_TEST_EQ(route_of(table, "/abc"), 1);
+    BOOST_TEST_EQ(route_of(table, "/abd"), 2);
+    BOOST_TEST_EQ(route_of(table, "/ab"), 3);
+    BOOST_TEST_EQ(route_of(table, "/abc/def"), 4);
+
+    BOOST_TEST_EQ(route_of(table, ""), -1);
+    BOOST_TEST_EQ(route_of(table, "/a"), -1);
+    BOOST_TEST_EQ(route_of(table, "/abcd"), -1);
+    BOOST_TEST_EQ(route_of(table, "/abc/"), -1);
+    BOOST_TEST_EQ(route_of(table, "/ABC"), -1);
+
+    BOOST_TEST(table.match("/abc").params.empty());
+}
+
+void test_parameters()
+{
+    RouteTable<int> table;
+    table.insert("/user/{id}", 1);
+    table.insert("/user/{id}/posts/{post}", 2);
+
+    std::string_view const path = "/user/42/posts/7";
+    auto const m = table.match(path);
+    BOOST_TEST(m);
+    BOOST_TEST_EQ(*m.value, 2);
+    BOOST_TEST_EQ(m.params.size(), 2u);
+    BOOST_TEST_EQ(m.params["id"], "42");
+    BOOST_TEST_EQ(m.params["post"], "7");
+    BOOST_TEST(!m.params.contains("user"));
+    BOOST_TEST(m.params[""].empty());
+
+    // values are views of the path
+    BOOST_TEST(m.params["id"].data() == path.data() + 6);
+
+    BOOST_TEST_EQ(route_of(table, "/user/42"), 1);
+
+    // a parameter is one whole, non-empty segment
+    BOOST_TEST_EQ(route_of(table, "/user/"), -1);
+    BOOST_TEST_EQ(route_of(table, "/user//posts/7"), -1);
+    BOOST_TEST_EQ(route_of(table, "/user/42/"), -1);
+    BOOST_TEST_EQ(route_of(table, "/user/42/posts/"), -1);
+}
+
+void test_wildcards()
+{
+    RouteTable<int> table;
+    table.insert("/*", 0);
+    table.insert("/static/*", 1);
+
+    auto const m = table.match("/static/js/app.js");
+    BOOST_TEST(m);
+    BOOST_TEST_EQ(*m.value, 1);
+    BOOST_TEST_EQ(m.params["*"], "js/app.js");
+
+    // the rest may be empty
+    BOOST_TEST_EQ(route_of(table, "/static/"), 1);
+    BOOST_TEST_EQ(table.match("/static/").params["*"], "");
+
+    BOOST_TEST_EQ(route_of(table, "/static"), 0);
+    BOOST_TEST_EQ(table.match("/static").params["*"], "static");
+    BOOST_TEST_EQ(route_of(table, "/"), 0);
+}
+
+void test_precedence()
+{
+    RouteTable<int> table;
+    table.insert("/user/me", 1);
+    table.insert("/user/{id}", 2);
+    table.insert("/user/*", 3);
+
+    // literal text over a parameter over a wildcard
+    BOOST_TEST_EQ(route_of(table, "/user/me"), 1);
+    BOOST_TEST_EQ(route_of(table, "/user/42"), 2);
+    BOOST_TEST_EQ(route_of(table, "/user/42/x"), 3);
+
+    // "me" is a prefix of the segment, not the segment
+    BOOST_TEST_EQ(route_of(table, "/user/mee"), 2);
+    BOOST_TEST_EQ(table.match("/user/mee").params["id"], "mee");
+}
+
+void test_backtracking()
+{
+    RouteTable<int> table;
+    table.insert("/a/b/c", 1);
+    table.insert("/a/{x}/d", 2);
+    table.insert("/a/{x}/{y}/e", 3);
+    table.insert("/a/*", 4);
+
+    BOOST_TEST_EQ(route_of(table, "/a/b/c"), 1);
+
+    // the literal branch fails after "/a/b"; the parameter takes over
+    auto const d = table.match("/a/b/d");
+    BOOST_TEST(d);
+    BOOST_TEST_EQ(*d.value, 2);
+    BOOST_TEST_EQ(d.params.size(), 1u);
+    BOOST_TEST_EQ(d.params["x"], "b");
+
+    auto const e = table.match("/a/b/c/e");
+    BOOST_TEST(e);
+    BOOST_TEST_EQ(*e.value, 3);
+    BOOST_TEST_EQ(e.params["x"], "b");
+    BOOST_TEST_EQ(e.params["y"], "c");
+
+    // parameters captured on failed branches are dropped
+    auto const rest = table.match("/a/b/c/f");
+    BOOST_TEST(rest);
+    BOOST_TEST_EQ(*rest.value, 4);
+    BOOST_TEST_EQ(rest.params.size(), 1u);
+    BOOST_TEST_EQ(rest.params["*"], "b/c/f");
+    BOOST_TEST(!rest.params.contains("x"));
+}
+
+void test_invalid_patterns()
+{
+    auto const throws = [](std::string_view pattern) {
+        RouteTable<int> table;
+        table.insert("/a/{x}/b", 0);
+        table.insert("/c/*", 0);
+        try {
+            table.insert(pattern, 1);
+        } catch (std::invalid_argument const&) {
+            return true;
+        }
+        return false;
+    };
+
+    BOOST_TEST(throws(""));
+    BOOST_TEST(throws("a"));
+    BOOST_TEST(throws("/a{x}"));
+    BOOST_TEST(throws("/a/x*"));
+    BOOST_TEST(throws("/a/*/b"));
+    BOOST_TEST(throws("/a/{x"));
+    BOOST_TEST(throws("/a/{x}y"));
+    BOOST_TEST(throws("/a/{}"));
+    BOOST_TEST(throws("/a/{*}"));
+    BOOST_TEST(throws("/1/{a}/{b}/{c}/{d}/{e}/{f}/{g}/{h}"));
+
+    // already routed, or a parameter of another name at the same place
+    BOOST_TEST(throws("/a/{x}/b"));
+    BOOST_TEST(throws("/c/*"));
+    BOOST_TEST(throws("/a/{y}"));
+
+    BOOST_TEST(!throws("/a/{x}"));
+    BOOST_TEST(!throws("/a/{x}/*"));
+    BOOST_TEST(!throws("/1/{a}/{b}/{c}/{d}/{e}/{f}/{g}"));
+}
+
+} // anon
+
+int main()
+{
+    test_literal_routes();
+    test_parameters();
+    test_wildcards();
+    test_precedence();
+    test_backtracking();
+    test_invalid_patterns();
+    return boost::report_errors();
+}
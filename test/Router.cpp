@@ -0,0 +1,96 @@
+﻿#include "vein/Controller.hpp"
+#include "vein/Router.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+
+namespace {
+
+using namespace vein;
+
+// Records the request paths it serves, with the captured "name" if any
+class RecordingController : public CustomController<RecordingController>
+{
+public:
+    explicit RecordingController(std::string* log)
+    {
+        auto html = std::make_unique<html::Tag>(html::TagType::html);
+        html->contents().emplace_back(html::allocate_tag(std::pmr::get_default_resource(), html::TagType::head));
+        html->contents().emplace_back(html::allocate_tag(std::pmr::get_default_resource(), html::TagType::body));
+        this->set_html(std::move(html));
+
+        this->set_default_callback([this, log](boost::urls::url_view const&, HTTPFields&) {
+            *log = this->params().contains("name") ? std::string{this->params()["name"]} : "reached";
+            return http::status::ok;
+        });
+    }
+};
+
+// What the controllers of `router` logged for a GET of `target`
+std::string route(Router& router, std::string* log, char const* target)
+{
+    log->clear();
+    http::request<http::string_body> req{http::verb::get, target, 11};
+    req.set(http::field::host, "localhost");
+    (void)router.handle_request(std::move(req));
+    return *log;
+}
+
+void test_encoded_paths()
+{
+    std::string log;
+
+    // no public files, so nothing is watched
+    Router router{"vein_test_router_no_such_root"};
+    router.route("/abc", std::make_unique<RecordingController>(&log));
+    router.route("/user/{name}", std::make_unique<RecordingController>(&log));
+    router.route("/caf\xC3\xA9", std::make_unique<RecordingController>(&log));
+
+    BOOST_TEST_EQ(route(router, &log, "/abc"), "reached");
+    BOOST_TEST_EQ(route(router, &log, "/ab%63"), "reached");
+    BOOST_TEST_EQ(route(router, &log, "/%61%62%63"), "reached");
+    BOOST_TEST_EQ(route(router, &log, "/caf%C3%A9"), "reached");
+
+    // captures are decoded
+    BOOST_TEST_EQ(route(router, &log, "/user/alice"), "alice");
+    BOOST_TEST_EQ(route(router, &log, "/user/J%C3%BCrgen"), "J\xC3\xBCrgen");
+    BOOST_TEST_EQ(route(router, &log, "/user/a%20b"), "a b");
+
+    // decoded once only, and "%2F" separates segments
+    BOOST_TEST_EQ(route(router, &log, "/ab%2563"), "");
+    BOOST_TEST_EQ(route(router, &log, "/user/a%2Fb"), "");
+
+    // ".." is refused however it is spelled
+    BOOST_TEST_EQ(route(router, &log, "/user/%2E%2E"), "");
+}
+
+void test_request_body_options()
+{
+    std::string log;
+    Router router{"vein_test_router_no_such_root"};
+
+    auto controller = std::make_unique<RecordingController>(&log);
+    controller->set_request_body_options({.limit = 12345, .memory_limit = 12345});
+    router.route("/upload/{name}", std::move(controller));
+
+    http::request_header<> header;
+    header.method(http::verb::post);
+    header.target("/%75pload/x");
+    BOOST_TEST_EQ(router.request_body_options(header).limit, 12345u);
+
+    header.target("/upload");
+    BOOST_TEST_NE(router.request_body_options(header).limit, 12345u);
+}
+
+} // namespace
+
+int main()
+{
+    test_encoded_paths();
+    test_request_body_options();
+    return boost::report_errors();
+}
@@ -0,0 +1,96 @@
+﻿#include "vein/html/Template.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace {
+
+using namespace vein;
+using html::Template;
+
+std::string render(Template const& tpl, std::initializer_list<std::string_view> values)
+{
+    std::vector<std::string_view> const v{values};
+    html::OutputBuffer out;
+    tpl.render(out, v);
+    return std::string{out.view()};
+}
+
+void test_no_slots()
+{
+    auto const tpl = Template::parse("<p>plain { text } and }}</p>");
+    BOOST_TEST(tpl.names().empty());
+    BOOST_TEST_EQ(tpl.static_size(), 28u);
+    BOOST_TEST_EQ(render(tpl, {}), "<p>plain { text } and }}</p>");
+
+    auto const empty = Template::parse("");
+    BOOST_TEST(empty.names().empty());
+    BOOST_TEST_EQ(render(empty, {}), "");
+}
+
+void test_slots()
+{
+    auto const tpl = Template::parse("{{a}}<b>{{ b }}</b>{{a}}");
+    BOOST_TEST_EQ(tpl.names().size(), 2u);
+    BOOST_TEST_EQ(tpl.names()[0], "a");
+    BOOST_TEST_EQ(tpl.names()[1], "b");
+    BOOST_TEST_EQ(tpl.static_size(), 7u);
+    BOOST_TEST_EQ(tpl.find("a").value_or(99), 0u);
+    BOOST_TEST_EQ(tpl.find("b").value_or(99), 1u);
+    BOOST_TEST(!tpl.find("c"));
+
+    // repeated names share one value
+    BOOST_TEST_EQ(render(tpl, {"x", "y"}), "x<b>y</b>x");
+
+    // missing values render empty
+    BOOST_TEST_EQ(render(tpl, {"x"}), "x<b></b>x");
+    BOOST_TEST_EQ(render(tpl, {}), "<b></b>");
+}
+
+void test_escaping()
+{
+    auto const tpl = Template::parse("<p>{{text}}</p>{{& text }}{{&html}}");
+    BOOST_TEST_EQ(tpl.names().size(), 2u);
+    BOOST_TEST_EQ(tpl.names()[0], "text");
+    BOOST_TEST_EQ(tpl.names()[1], "html");
+
+    // the same name may be used both escaped and raw
+    BOOST_TEST_EQ(render(tpl, {"<a & 'b'>", "<i>\"c\"</i>"}), "<p>&lt;a &amp; &#39;b&#39;&gt;</p><a & 'b'><i>\"c\"</i>");
+}
+
+void test_malformed()
+{
+    BOOST_TEST_THROWS(Template::parse("{{"), std::invalid_argument);
+    BOOST_TEST_THROWS(Template::parse("abc{{name"), std::invalid_argument);
+    BOOST_TEST_THROWS(Template::parse("{{a}} {{b}"), std::invalid_argument);
+
+    BOOST_TEST_THROWS(Template::parse("{{}}"), std::invalid_argument);
+    BOOST_TEST_THROWS(Template::parse("{{  }}"), std::invalid_argument);
+    BOOST_TEST_THROWS(Template::parse("{{&}}"), std::invalid_argument);
+    BOOST_TEST_THROWS(Template::parse("{{ & }}"), std::invalid_argument);
+
+    // the offset of the slot is reported
+    try {
+        (void)Template::parse("0123{{a}}{{");
+        BOOST_ERROR("no exception");
+    } catch (std::invalid_argument const& e) {
+        BOOST_TEST(std::string_view{e.what()}.ends_with("offset 9"));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    test_no_slots();
+    test_slots();
+    test_escaping();
+    test_malformed();
+    return boost::report_errors();
+}
@@ -0,0 +1,134 @@
+﻿#include "vein/Validators.hpp"
+
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <chrono>
+
+
+namespace {
+
+using namespace vein;
+using namespace std::chrono;
+
+// The example of RFC 9110 5.6.7
+constexpr sys_seconds example_date = sys_days{1994y / November / 6} + 8h + 49min + 37s;
+
+http::request<http::empty_body> make_request(http::field field, char const* value)
+{
+    http::request<http::empty_body> req{http::verb::get, "/", 11};
+    req.set(field, value);
+    return req;
+}
+
+void test_format_http_date()
+{
+    BOOST_TEST_EQ(format_http_date(example_date), "Sun, 06 Nov 1994 08:49:37 GMT");
+    BOOST_TEST_EQ(format_http_date(sys_seconds{}), "Thu, 01 Jan 1970 00:00:00 GMT");
+    BOOST_TEST_EQ(format_http_date(sys_days{2024y / February / 29} + 23h + 59min + 59s), "Thu, 29 Feb 2024 23:59:59 GMT");
+}
+
+void test_parse_http_date()
+{
+    BOOST_TEST(parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT") == example_date);
+    BOOST_TEST(parse_http_date(" \tSun, 06 Nov 1994 08:49:37 GMT ") == example_date);
+
+    auto const now = floor<seconds>(system_clock::now());
+    BOOST_TEST(parse_http_date(format_http_date(now)) == now);
+
+    // obsolete formats (RFC 9110 5.6.7) are ignored
+    BOOST_TEST(!parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT"));
+    BOOST_TEST(!parse_http_date("Sun Nov  6 08:49:37 1994"));
+
+    // malformed
+    BOOST_TEST(!parse_http_date(""));
+    BOOST_TEST(!parse_http_date("Sun, 06 Nov 1994 08:49:37 UTC"));
+    BOOST_TEST(!parse_http_date("Sun, 06 nov 1994 08:49:37 GMT"));
+    BOOST_TEST(!parse_http_date("Sun, 6 Nov 1994 08:49:37 GMT"));
+    BOOST_TEST(!parse_http_date("Sun, 06 Nov 1994 08:49:3x GMT"));
+    BOOST_TEST(!parse_http_date("Sun, 06 Nov 1994 08-49-37 GMT"));
+    BOOST_TEST(!parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT,"));
+
+    // out of range
+    BOOST_TEST(!parse_http_date("Sun, 06 Nov 1994 24:00:00 GMT"));
+    BOOST_TEST(!parse_http_date("Sun, 06 Nov 1994 08:60:00 GMT"));
+    BOOST_TEST(!parse_http_date("Tue, 29 Feb 2022 08:49:37 GMT"));
+    BOOST_TEST(!parse_http_date("Sun, 00 Nov 1994 08:49:37 GMT"));
+    BOOST_TEST(parse_http_date("Thu, 29 Feb 2024 08:49:37 GMT"));
+}
+
+void test_etag_list_matches()
+{
+    BOOST_TEST(etag_list_matches("\"a\"", "\"a\""));
+    BOOST_TEST(etag_list_matches("*", "\"a\""));
+    BOOST_TEST(etag_list_matches(" \"x\" ,\t\"a\" ", "\"a\""));
+    BOOST_TEST(!etag_list_matches("\"x\", \"y\"", "\"a\""));
+    BOOST_TEST(!etag_list_matches("", "\"a\""));
+
+    // weak comparison
+    BOOST_TEST(etag_list_matches("W/\"a\"", "\"a\""));
+    BOOST_TEST(etag_list_matches("\"a\"", "W/\"a\""));
+}
+
+void test_make_etag()
+{
+    FileInfo const info{.size = 1234, .inode = 42, .mtime_ns = 1'000'000'000};
+
+    auto const identity = make_etag(info, ContentEncoding::identity);
+    BOOST_TEST(identity.starts_with('"') && identity.ends_with('"'));
+    BOOST_TEST_NE(identity, make_etag(info, ContentEncoding::gzip));
+    BOOST_TEST_NE(make_etag(info, ContentEncoding::gzip), make_etag(info, ContentEncoding::br));
+
+    auto modified = info;
+    ++modified.mtime_ns;
+    BOOST_TEST_NE(identity, make_etag(modified, ContentEncoding::identity));
+}
+
+void test_is_not_modified()
+{
+    auto const etag = "\"a\"";
+
+    BOOST_TEST(!is_not_modified(http::request<http::empty_body>{}, etag, example_date));
+
+    BOOST_TEST(is_not_modified(make_request(http::field::if_none_match, "\"a\""), etag, example_date));
+    BOOST_TEST(!is_not_modified(make_request(http::field::if_none_match, "\"b\""), etag, example_date));
+
+    BOOST_TEST(is_not_modified(make_request(http::field::if_modified_since, "Sun, 06 Nov 1994 08:49:37 GMT"), etag, example_date));
+    BOOST_TEST(is_not_modified(make_request(http::field::if_modified_since, "Mon, 07 Nov 1994 08:49:37 GMT"), etag, example_date));
+    BOOST_TEST(!is_not_modified(make_request(http::field::if_modified_since, "Sat, 05 Nov 1994 08:49:37 GMT"), etag, example_date));
+    BOOST_TEST(!is_not_modified(make_request(http::field::if_modified_since, "yesterday"), etag, example_date));
+
+    // If-Modified-Since is ignored when If-None-Match is present
+    auto req = make_request(http::field::if_none_match, "\"b\"");
+    req.set(http::field::if_modified_since, "Mon, 07 Nov 1994 08:49:37 GMT");
+    BOOST_TEST(!is_not_modified(req, etag, example_date));
+}
+
+void test_if_range_matches()
+{
+    auto const etag = "\"a\"";
+
+    BOOST_TEST(if_range_matches(http::request<http::empty_body>{}, etag, example_date));
+
+    BOOST_TEST(if_range_matches(make_request(http::field::if_range, "\"a\""), etag, example_date));
+    BOOST_TEST(!if_range_matches(make_request(http::field::if_range, "\"b\""), etag, example_date));
+    BOOST_TEST(!if_range_matches(make_request(http::field::if_range, "W/\"a\""), etag, example_date));
+
+    // dates must match exactly
+    BOOST_TEST(if_range_matches(make_request(http::field::if_range, "Sun, 06 Nov 1994 08:49:37 GMT"), etag, example_date));
+    BOOST_TEST(!if_range_matches(make_request(http::field::if_range, "Mon, 07 Nov 1994 08:49:37 GMT"), etag, example_date));
+    BOOST_TEST(!if_range_matches(make_request(http::field::if_range, "garbage"), etag, example_date));
+}
+
+} // anon
+
+int main()
+{
+    test_format_http_date();
+    test_parse_http_date();
+    test_etag_list_matches();
+    test_make_etag();
+    test_is_not_modified();
+    test_if_range_matches();
+    return boost::report_errors();
+}